@@ -72,5 +72,7 @@ struct word_format aa_word_format = {
   get_aa_word,
   NULL,
   write_aa_word,
+  NULL,
+  NULL,
   NULL
 };
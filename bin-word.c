@@ -14,12 +14,10 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "dis.h"
 
-static int leftover_input, have_leftover_input = 0;
-static int leftover_output, have_leftover_output = 0;
-
 static inline int
 get_byte (FILE *f)
 {
@@ -36,14 +34,14 @@ get_bin_word (FILE *f)
   if (feof (f))
     return -1;
 
-  if (have_leftover_input)
+  if (dis10->input.have_leftover)
     {
-      word = (word_t)leftover_input << 32 |
+      word = (word_t)dis10->input.leftover << 32 |
 	     (word_t)get_byte (f) << 24 |
 	     (word_t)get_byte (f) << 16 |
              (word_t)get_byte (f) <<  8 |
              (word_t)get_byte (f) <<  0;
-      have_leftover_input = 0;
+      dis10->input.have_leftover = 0;
     }
   else
     {
@@ -55,37 +53,97 @@ get_bin_word (FILE *f)
               ((word_t)get_byte (f) <<  4);
       byte = get_byte (f);
       word |=  (word_t)byte >> 4;
-      have_leftover_input = 1;
-      leftover_input = byte & 0x0f;
+      dis10->input.have_leftover = 1;
+      dis10->input.leftover = byte & 0x0f;
     }
 
   if (word > WORDMASK)
     {
       fprintf (stderr, "[error in 36/8 format]\n");
-      exit (1);
+      dis10_fail ();
     }
 
   return word;
 }
 
+static int
+get_bin_words (FILE *f, word_t *buffer, int n)
+{
+  unsigned char data[9 * 512];
+  int count = 0, pairs, rest;
+  size_t size, got;
+  word_t word, pair[2];
+
+  /* Finish off a split pair first. */
+  if (dis10->input.have_leftover && n > 0)
+    {
+      word = get_bin_word (f);
+      if (word == -1)
+	return 0;
+      buffer[count++] = word;
+    }
+
+  while (n - count >= 2 && !feof (f) && !ferror (f))
+    {
+      pairs = (n - count) / 2;
+      if (pairs > (int)sizeof data / 9)
+	pairs = sizeof data / 9;
+
+      size = (size_t)pairs * 9;
+      got = fread (data, 1, size, f);
+      unpack_bin_words (data, buffer + count, got / 9);
+      count += 2 * (got / 9);
+
+      if (got < size)
+	{
+	  /* A partial pair at the end of the file gives one word if
+	     it's at most four octets, and two words otherwise.  Any
+	     missing octets are zero, as in get_bin_word. */
+	  rest = got % 9;
+	  if (rest == 0)
+	    return count;
+	  memset (data + got, 0, 9 - rest);
+	  unpack_bin_words (data + got - rest, pair, 1);
+	  buffer[count++] = pair[0];
+	  if (rest <= 4)
+	    {
+	      dis10->input.have_leftover = 1;
+	      dis10->input.leftover = data[got - rest + 4] & 0x0f;
+	    }
+	  else
+	    buffer[count++] = pair[1];
+	  return count;
+	}
+    }
+
+  if (count < n)
+    {
+      word = get_bin_word (f);
+      if (word != -1)
+	buffer[count++] = word;
+    }
+
+  return count;
+}
+
 static void
 rewind_bin_word (FILE *f)
 {
-  have_leftover_input = 0;
+  dis10->input.have_leftover = 0;
   rewind (f);
 }
 
 static void
 write_bin_word (FILE *f, word_t word)
 {
-  if (have_leftover_output)
+  if (dis10->output.have_leftover)
     {
-      fputc (leftover_output | ((word >> 32) & 0x0f), f);
+      fputc (dis10->output.leftover | ((word >> 32) & 0x0f), f);
       fputc ((word >> 24) & 0xff, f);
       fputc ((word >> 16) & 0xff, f);
       fputc ((word >>  8) & 0xff, f);
       fputc ((word >>  0) & 0xff, f);
-      have_leftover_output = 0;
+      dis10->output.have_leftover = 0;
     }
   else
     {
@@ -93,19 +151,47 @@ write_bin_word (FILE *f, word_t word)
       fputc ((word >> 20) & 0xff, f);
       fputc ((word >> 12) & 0xff, f);
       fputc ((word >>  4) & 0xff, f);
-      have_leftover_output = 1;
-      leftover_output = (word << 4) & 0xf0;
+      dis10->output.have_leftover = 1;
+      dis10->output.leftover = (word << 4) & 0xf0;
     }
 }
 
 static void
 flush_bin_word (FILE *f)
 {
-  if (have_leftover_output)
+  if (dis10->output.have_leftover)
+    {
+      fputc (dis10->output.leftover, f);
+      dis10->output.have_leftover = 0;
+    }
+}
+
+static void
+write_bin_words (FILE *f, const word_t *buffer, int n)
+{
+  unsigned char data[9 * 512];
+  int pairs;
+
+  /* Finish off a split pair first. */
+  if (dis10->output.have_leftover && n > 0)
+    {
+      write_bin_word (f, *buffer++);
+      n--;
+    }
+
+  while (n >= 2)
     {
-      fputc (leftover_output, f);
-      have_leftover_output = 0;
+      pairs = n / 2;
+      if (pairs > 512)
+	pairs = 512;
+      pack_bin_words (buffer, data, pairs);
+      fwrite (data, 1, 9 * pairs, f);
+      buffer += 2 * pairs;
+      n -= 2 * pairs;
     }
+
+  if (n > 0)
+    write_bin_word (f, *buffer);
 }
 
 struct word_format bin_word_format = {
@@ -113,5 +199,7 @@ struct word_format bin_word_format = {
   get_bin_word,
   rewind_bin_word,
   write_bin_word,
-  flush_bin_word
+  flush_bin_word,
+  get_bin_words,
+  write_bin_words
 };
@@ -0,0 +1,491 @@
+/* Copyright (C) 2013 Lars Brinkhoff <lars@nocrew.org>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+/* Bulk conversion between words and the octets of the core, dta, and
+   bin word formats.  On x86-64, vectorized versions are selected at
+   run time according to what the CPU supports.  The vector loops may
+   load or store up to 16 octets past the current group, so they stop
+   early and leave the last few words to the scalar code. */
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include "dis.h"
+
+#if defined (__GNUC__) && defined (__x86_64__)
+#define BULK_X86 1
+#include <immintrin.h>
+#endif
+
+/* Core dump: each word is in five octets, the last holding four bits. */
+
+static void
+unpack_core_scalar (const unsigned char *data, word_t *words, int n)
+{
+  int i;
+
+  for (i = 0; i < n; i++, data += 5)
+    words[i] = ((word_t)data[0] << 28) |
+	       ((word_t)data[1] << 20) |
+	       ((word_t)data[2] << 12) |
+	       ((word_t)data[3] <<  4) |
+		(word_t)data[4];
+}
+
+static void
+pack_core_scalar (const word_t *words, unsigned char *data, int n)
+{
+  int i;
+
+  for (i = 0; i < n; i++, data += 5)
+    {
+      data[0] = (words[i] >> 28) & 0xFF;
+      data[1] = (words[i] >> 20) & 0xFF;
+      data[2] = (words[i] >> 12) & 0xFF;
+      data[3] = (words[i] >>  4) & 0xFF;
+      data[4] =  words[i]        & 0x0F;
+    }
+}
+
+/* DECtape: each word is two 18-bit halves, stored as little endian
+   32-bit numbers. */
+
+static void
+unpack_dta_scalar (const unsigned char *data, word_t *words, int n)
+{
+  word_t h1, h2;
+  int i;
+
+  for (i = 0; i < n; i++, data += 8)
+    {
+      h1 = (word_t)data[0] + ((word_t)data[1] << 8)
+	   + ((word_t)data[2] << 16) + ((word_t)data[3] << 24);
+      h2 = (word_t)data[4] + ((word_t)data[5] << 8)
+	   + ((word_t)data[6] << 16) + ((word_t)data[7] << 24);
+      words[i] = (h1 << 18) + h2;
+    }
+}
+
+static void
+pack_dta_scalar (const word_t *words, unsigned char *data, int n)
+{
+  int i, h;
+
+  for (i = 0; i < n; i++, data += 8)
+    {
+      h = (words[i] >> 18) & 0777777;
+      data[0] = h & 0377;
+      data[1] = (h >> 8) & 0377;
+      data[2] = (h >> 16) & 0377;
+      data[3] = 0;
+      h = words[i] & 0777777;
+      data[4] = h & 0377;
+      data[5] = (h >> 8) & 0377;
+      data[6] = (h >> 16) & 0377;
+      data[7] = 0;
+    }
+}
+
+/* Binary: two words in nine octets.  The count n is in pairs. */
+
+static void
+unpack_bin_scalar (const unsigned char *data, word_t *words, int n)
+{
+  int i;
+
+  for (i = 0; i < n; i++, data += 9, words += 2)
+    {
+      words[0] = (word_t)data[0] << 28 |
+		 (word_t)data[1] << 20 |
+		 (word_t)data[2] << 12 |
+		 (word_t)data[3] <<  4 |
+		 (word_t)data[4] >>  4;
+      words[1] = (word_t)(data[4] & 0x0f) << 32 |
+		 (word_t)data[5] << 24 |
+		 (word_t)data[6] << 16 |
+		 (word_t)data[7] <<  8 |
+		 (word_t)data[8] <<  0;
+    }
+}
+
+static void
+pack_bin_scalar (const word_t *words, unsigned char *data, int n)
+{
+  int i;
+
+  for (i = 0; i < n; i++, data += 9, words += 2)
+    {
+      data[0] = (words[0] >> 28) & 0xff;
+      data[1] = (words[0] >> 20) & 0xff;
+      data[2] = (words[0] >> 12) & 0xff;
+      data[3] = (words[0] >>  4) & 0xff;
+      data[4] = ((words[0] << 4) & 0xf0) | ((words[1] >> 32) & 0x0f);
+      data[5] = (words[1] >> 24) & 0xff;
+      data[6] = (words[1] >> 16) & 0xff;
+      data[7] = (words[1] >>  8) & 0xff;
+      data[8] =  words[1]        & 0xff;
+    }
+}
+
+#ifdef BULK_X86
+
+/* Shuffles operate on each 128-bit lane, holding two words.  An index
+   of -1 clears the octet. */
+#define SHUFFLE(...)  _mm_setr_epi8 (__VA_ARGS__)
+#define SHUFFLE2(...) _mm256_setr_epi8 (__VA_ARGS__, __VA_ARGS__)
+
+/* The first four core octets in big endian order, and the last one. */
+#define CORE_HIGH  3, 2, 1, 0,-1,-1,-1,-1, 8, 7, 6, 5,-1,-1,-1,-1
+#define CORE_LOW   4,-1,-1,-1,-1,-1,-1,-1, 9,-1,-1,-1,-1,-1,-1,-1
+/* From the 40-bit value (word >> 4) << 8 | (word & 017). */
+#define CORE_PACK  4, 3, 2, 1, 0,12,11,10, 9, 8,-1,-1,-1,-1,-1,-1
+/* A pair of bin words, the first shifted four bits left. */
+#define BIN_UNPACK 4, 3, 2, 1, 0,-1,-1,-1, 8, 7, 6, 5, 4,-1,-1,-1
+#define BIN_PACK1  4, 3, 2, 1, 0,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+#define BIN_PACK2 -1,-1,-1,-1,12,11,10, 9, 8,-1,-1,-1,-1,-1,-1,-1
+
+__attribute__ ((target ("ssse3"))) static void
+unpack_core_ssse3 (const unsigned char *data, word_t *words, int n)
+{
+  const __m128i high = SHUFFLE (CORE_HIGH);
+  const __m128i low = SHUFFLE (CORE_LOW);
+  __m128i x, y;
+  int i;
+
+  for (i = 0; i + 4 <= n; i += 2, data += 10)
+    {
+      x = _mm_loadu_si128 ((const __m128i *)data);
+      y = _mm_slli_epi64 (_mm_shuffle_epi8 (x, high), 4);
+      y = _mm_or_si128 (y, _mm_shuffle_epi8 (x, low));
+      _mm_storeu_si128 ((__m128i *)(words + i), y);
+    }
+
+  unpack_core_scalar (data, words + i, n - i);
+}
+
+__attribute__ ((target ("avx2"))) static void
+unpack_core_avx2 (const unsigned char *data, word_t *words, int n)
+{
+  const __m256i high = SHUFFLE2 (CORE_HIGH);
+  const __m256i low = SHUFFLE2 (CORE_LOW);
+  __m256i x, y;
+  int i;
+
+  for (i = 0; i + 6 <= n; i += 4, data += 20)
+    {
+      x = _mm256_castsi128_si256 (_mm_loadu_si128 ((const __m128i *)data));
+      x = _mm256_inserti128_si256 (x, _mm_loadu_si128 ((const __m128i *)
+						       (data + 10)), 1);
+      y = _mm256_slli_epi64 (_mm256_shuffle_epi8 (x, high), 4);
+      y = _mm256_or_si256 (y, _mm256_shuffle_epi8 (x, low));
+      _mm256_storeu_si256 ((__m256i *)(words + i), y);
+    }
+
+  unpack_core_scalar (data, words + i, n - i);
+}
+
+__attribute__ ((target ("ssse3"))) static void
+pack_core_ssse3 (const word_t *words, unsigned char *data, int n)
+{
+  const __m128i shuffle = SHUFFLE (CORE_PACK);
+  const __m128i nibble = _mm_set1_epi64x (017);
+  __m128i x, y;
+  int i;
+
+  for (i = 0; i + 4 <= n; i += 2, data += 10)
+    {
+      x = _mm_loadu_si128 ((const __m128i *)(words + i));
+      y = _mm_slli_epi64 (_mm_srli_epi64 (x, 4), 8);
+      y = _mm_or_si128 (y, _mm_and_si128 (x, nibble));
+      _mm_storeu_si128 ((__m128i *)data, _mm_shuffle_epi8 (y, shuffle));
+    }
+
+  pack_core_scalar (words + i, data, n - i);
+}
+
+__attribute__ ((target ("avx2"))) static void
+pack_core_avx2 (const word_t *words, unsigned char *data, int n)
+{
+  const __m256i shuffle = SHUFFLE2 (CORE_PACK);
+  const __m256i nibble = _mm256_set1_epi64x (017);
+  __m256i x, y;
+  int i;
+
+  for (i = 0; i + 6 <= n; i += 4, data += 20)
+    {
+      x = _mm256_loadu_si256 ((const __m256i *)(words + i));
+      y = _mm256_slli_epi64 (_mm256_srli_epi64 (x, 4), 8);
+      y = _mm256_or_si256 (y, _mm256_and_si256 (x, nibble));
+      y = _mm256_shuffle_epi8 (y, shuffle);
+      _mm_storeu_si128 ((__m128i *)data, _mm256_castsi256_si128 (y));
+      _mm_storeu_si128 ((__m128i *)(data + 10),
+			_mm256_extracti128_si256 (y, 1));
+    }
+
+  pack_core_scalar (words + i, data, n - i);
+}
+
+__attribute__ ((target ("sse2"))) static void
+unpack_dta_sse2 (const unsigned char *data, word_t *words, int n)
+{
+  const __m128i half = _mm_set1_epi64x (0xFFFFFFFFLL);
+  __m128i x, y;
+  int i;
+
+  for (i = 0; i + 2 <= n; i += 2, data += 16)
+    {
+      x = _mm_loadu_si128 ((const __m128i *)data);
+      y = _mm_slli_epi64 (_mm_and_si128 (x, half), 18);
+      y = _mm_add_epi64 (y, _mm_srli_epi64 (x, 32));
+      _mm_storeu_si128 ((__m128i *)(words + i), y);
+    }
+
+  unpack_dta_scalar (data, words + i, n - i);
+}
+
+__attribute__ ((target ("avx2"))) static void
+unpack_dta_avx2 (const unsigned char *data, word_t *words, int n)
+{
+  const __m256i half = _mm256_set1_epi64x (0xFFFFFFFFLL);
+  __m256i x, y;
+  int i;
+
+  for (i = 0; i + 4 <= n; i += 4, data += 32)
+    {
+      x = _mm256_loadu_si256 ((const __m256i *)data);
+      y = _mm256_slli_epi64 (_mm256_and_si256 (x, half), 18);
+      y = _mm256_add_epi64 (y, _mm256_srli_epi64 (x, 32));
+      _mm256_storeu_si256 ((__m256i *)(words + i), y);
+    }
+
+  unpack_dta_scalar (data, words + i, n - i);
+}
+
+__attribute__ ((target ("sse2"))) static void
+pack_dta_sse2 (const word_t *words, unsigned char *data, int n)
+{
+  const __m128i half = _mm_set1_epi64x (0777777);
+  __m128i x, y;
+  int i;
+
+  for (i = 0; i + 2 <= n; i += 2, data += 16)
+    {
+      x = _mm_loadu_si128 ((const __m128i *)(words + i));
+      y = _mm_and_si128 (_mm_srli_epi64 (x, 18), half);
+      y = _mm_or_si128 (y, _mm_slli_epi64 (_mm_and_si128 (x, half), 32));
+      _mm_storeu_si128 ((__m128i *)data, y);
+    }
+
+  pack_dta_scalar (words + i, data, n - i);
+}
+
+__attribute__ ((target ("avx2"))) static void
+pack_dta_avx2 (const word_t *words, unsigned char *data, int n)
+{
+  const __m256i half = _mm256_set1_epi64x (0777777);
+  __m256i x, y;
+  int i;
+
+  for (i = 0; i + 4 <= n; i += 4, data += 32)
+    {
+      x = _mm256_loadu_si256 ((const __m256i *)(words + i));
+      y = _mm256_and_si256 (_mm256_srli_epi64 (x, 18), half);
+      y = _mm256_or_si256 (y, _mm256_slli_epi64 (_mm256_and_si256 (x, half),
+						 32));
+      _mm256_storeu_si256 ((__m256i *)data, y);
+    }
+
+  pack_dta_scalar (words + i, data, n - i);
+}
+
+__attribute__ ((target ("ssse3"))) static void
+unpack_bin_ssse3 (const unsigned char *data, word_t *words, int n)
+{
+  const __m128i shuffle = SHUFFLE (BIN_UNPACK);
+  const __m128i first = _mm_set_epi64x (0, WORDMASK);
+  const __m128i second = _mm_set_epi64x (WORDMASK, 0);
+  __m128i x, y;
+  int i;
+
+  for (i = 0; i + 2 <= n; i++, data += 9, words += 2)
+    {
+      x = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)data), shuffle);
+      y = _mm_and_si128 (_mm_srli_epi64 (x, 4), first);
+      y = _mm_or_si128 (y, _mm_and_si128 (x, second));
+      _mm_storeu_si128 ((__m128i *)words, y);
+    }
+
+  unpack_bin_scalar (data, words, n - i);
+}
+
+__attribute__ ((target ("avx2"))) static void
+unpack_bin_avx2 (const unsigned char *data, word_t *words, int n)
+{
+  const __m256i shuffle = SHUFFLE2 (BIN_UNPACK);
+  const __m256i shift = _mm256_setr_epi64x (4, 0, 4, 0);
+  const __m256i mask = _mm256_set1_epi64x (WORDMASK);
+  __m256i x;
+  int i;
+
+  for (i = 0; i + 3 <= n; i += 2, data += 18, words += 4)
+    {
+      x = _mm256_castsi128_si256 (_mm_loadu_si128 ((const __m128i *)data));
+      x = _mm256_inserti128_si256 (x, _mm_loadu_si128 ((const __m128i *)
+						       (data + 9)), 1);
+      x = _mm256_srlv_epi64 (_mm256_shuffle_epi8 (x, shuffle), shift);
+      _mm256_storeu_si256 ((__m256i *)words, _mm256_and_si256 (x, mask));
+    }
+
+  unpack_bin_scalar (data, words, n - i);
+}
+
+__attribute__ ((target ("ssse3"))) static void
+pack_bin_ssse3 (const word_t *words, unsigned char *data, int n)
+{
+  const __m128i shuffle1 = SHUFFLE (BIN_PACK1);
+  const __m128i shuffle2 = SHUFFLE (BIN_PACK2);
+  const __m128i mask = _mm_set1_epi64x (WORDMASK);
+  __m128i x;
+  int i;
+
+  for (i = 0; i + 2 <= n; i++, data += 9, words += 2)
+    {
+      x = _mm_and_si128 (_mm_loadu_si128 ((const __m128i *)words), mask);
+      x = _mm_or_si128 (_mm_shuffle_epi8 (_mm_slli_epi64 (x, 4), shuffle1),
+			_mm_shuffle_epi8 (x, shuffle2));
+      _mm_storeu_si128 ((__m128i *)data, x);
+    }
+
+  pack_bin_scalar (words, data, n - i);
+}
+
+#endif /* BULK_X86 */
+
+static void (*unpack_core) (const unsigned char *, word_t *, int);
+static void (*pack_core) (const word_t *, unsigned char *, int);
+static void (*unpack_dta) (const unsigned char *, word_t *, int);
+static void (*pack_dta) (const word_t *, unsigned char *, int);
+static void (*unpack_bin) (const unsigned char *, word_t *, int);
+static void (*pack_bin) (const word_t *, unsigned char *, int);
+
+static int
+select_functions (int level)
+{
+  unpack_core = unpack_core_scalar;
+  pack_core = pack_core_scalar;
+  unpack_dta = unpack_dta_scalar;
+  pack_dta = pack_dta_scalar;
+  unpack_bin = unpack_bin_scalar;
+  pack_bin = pack_bin_scalar;
+
+#ifdef BULK_X86
+  __builtin_cpu_init ();
+  if (level > BULK_AVX2)
+    level = BULK_AVX2;
+  if (level >= BULK_AVX2 && !__builtin_cpu_supports ("avx2"))
+    level = BULK_SSSE3;
+  if (level >= BULK_SSSE3 && !__builtin_cpu_supports ("ssse3"))
+    level = BULK_SCALAR;
+
+  if (level >= BULK_SSSE3)
+    {
+      unpack_core = unpack_core_ssse3;
+      pack_core = pack_core_ssse3;
+      unpack_dta = unpack_dta_sse2;
+      pack_dta = pack_dta_sse2;
+      unpack_bin = unpack_bin_ssse3;
+      pack_bin = pack_bin_ssse3;
+    }
+  if (level >= BULK_AVX2)
+    {
+      unpack_core = unpack_core_avx2;
+      pack_core = pack_core_avx2;
+      unpack_dta = unpack_dta_avx2;
+      pack_dta = pack_dta_avx2;
+      unpack_bin = unpack_bin_avx2;
+    }
+#else
+  level = BULK_SCALAR;
+#endif
+
+  return level;
+}
+
+static pthread_once_t bulk_once = PTHREAD_ONCE_INIT;
+
+static void
+bulk_default (void)
+{
+  select_functions (BULK_AVX2);
+}
+
+/* The default is selected once, before any thread can use the
+   functions. */
+static void
+bulk_init (void)
+{
+  pthread_once (&bulk_once, bulk_default);
+}
+
+/* Select the conversion functions for the given level, or the best
+   one the CPU supports if it's lower.  Returns the level used. */
+int
+bulk_select (int level)
+{
+  bulk_init ();
+  return select_functions (level);
+}
+
+void
+unpack_core_words (const unsigned char *data, word_t *words, int n)
+{
+  bulk_init ();
+  unpack_core (data, words, n);
+}
+
+void
+pack_core_words (const word_t *words, unsigned char *data, int n)
+{
+  bulk_init ();
+  pack_core (words, data, n);
+}
+
+void
+unpack_dta_words (const unsigned char *data, word_t *words, int n)
+{
+  bulk_init ();
+  unpack_dta (data, words, n);
+}
+
+void
+pack_dta_words (const word_t *words, unsigned char *data, int n)
+{
+  bulk_init ();
+  pack_dta (words, data, n);
+}
+
+void
+unpack_bin_words (const unsigned char *data, word_t *words, int pairs)
+{
+  bulk_init ();
+  unpack_bin (data, words, pairs);
+}
+
+void
+pack_bin_words (const word_t *words, unsigned char *data, int pairs)
+{
+  bulk_init ();
+  pack_bin (words, data, pairs);
+}
@@ -0,0 +1,313 @@
+/* Copyright (C) 2026 Lars Brinkhoff <lars@nocrew.org>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+/* Cache of loaded images.  A .d10c file holds what loading a file
+   printed, the memory areas, and the symbols, so a later run can map
+   it and start disassembling at once.  It's named by a hash of the
+   input file and the options which affect loading.  All sections
+   start on a multiple of eight bytes, so the words can be used where
+   they are.  The byte order is the host's; a file from another host
+   fails the check of the header. */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+#include "memory.h"
+#include "symbols.h"
+
+#define CACHE_MAGIC	"D10C"
+#define CACHE_VERSION	1
+
+struct cache_header
+{
+  char magic[4];
+  unsigned int version;
+  unsigned long long key;
+  unsigned long long text, text_size;
+  unsigned long long area, areas;
+  unsigned long long symbol, symbols;
+  unsigned long long names, names_size;
+};
+
+struct cache_area
+{
+  long long start;
+  long long end;
+  unsigned long long data;
+};
+
+struct cache_symbol
+{
+  unsigned long long name;
+  long long value;
+  long long flags;
+};
+
+#define ALIGN(n)	(((n) + 7) & ~7ULL)
+
+/* FNV-1a. */
+static unsigned long long
+hash (unsigned long long h, const unsigned char *data, size_t n)
+{
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    {
+      h ^= data[i];
+      h *= 0x100000001b3ULL;
+    }
+
+  return h;
+}
+
+/* Return the name of the cache file for a file loaded with some
+   options, and its key, or NULL if the file can't be read for the
+   hash.  The directory is made if needed. */
+char *
+cache_path (const char *dir, FILE *f, const char *options,
+	    unsigned long long *key)
+{
+  unsigned char buffer[65536];
+  unsigned long long h = 0xcbf29ce484222325ULL;
+  unsigned int version = CACHE_VERSION;
+  off_t offset = 0;
+  ssize_t n;
+  char *path;
+
+  while ((n = pread (fileno (f), buffer, sizeof buffer, offset)) > 0)
+    {
+      h = hash (h, buffer, n);
+      offset += n;
+    }
+  if (n < 0)
+    return NULL;
+  h = hash (h, (const unsigned char *)options, strlen (options));
+  h = hash (h, (const unsigned char *)&version, sizeof version);
+
+  if (mkdir (dir, 0777) == -1 && errno != EEXIST)
+    return NULL;
+
+  path = malloc (strlen (dir) + 23);
+  if (path == NULL)
+    {
+      fprintf (stderr, "Out of memory\n");
+      exit (1);
+    }
+  sprintf (path, "%s/%016llx.d10c", dir, h);
+  *key = h;
+  return path;
+}
+
+static int
+inside (unsigned long long offset, unsigned long long n,
+	unsigned long long size, size_t map_size)
+{
+  return offset <= map_size && n <= (map_size - offset) / size;
+}
+
+/* Map a cache file, print its text, and add its areas and symbols.
+   Return -1 if there's no valid cache file. */
+int
+read_cache (const char *path, unsigned long long key,
+	    struct pdp10_memory *memory, struct cache_map *map)
+{
+  const struct cache_header *header;
+  const struct cache_area *area;
+  const struct cache_symbol *symbol;
+  const char *base, *names;
+  unsigned long long i;
+  struct stat st;
+  int fd;
+
+  fd = open (path, O_RDONLY);
+  if (fd == -1)
+    return -1;
+  if (fstat (fd, &st) == -1 || (size_t)st.st_size < sizeof *header)
+    {
+      close (fd);
+      return -1;
+    }
+
+  /* Private and writable, so nothing can change the file through the
+     memory areas. */
+  map->size = st.st_size;
+  map->base = mmap (NULL, map->size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+		    fd, 0);
+  close (fd);
+  if (map->base == MAP_FAILED)
+    {
+      map->base = NULL;
+      return -1;
+    }
+
+  base = map->base;
+  header = map->base;
+  area = (const struct cache_area *)(base + header->area);
+  symbol = (const struct cache_symbol *)(base + header->symbol);
+  names = base + header->names;
+  if (memcmp (header->magic, CACHE_MAGIC, 4) != 0
+      || header->version != CACHE_VERSION
+      || header->key != key
+      || !inside (header->text, header->text_size, 1, map->size)
+      || !inside (header->area, header->areas, sizeof *area, map->size)
+      || !inside (header->symbol, header->symbols, sizeof *symbol,
+		  map->size)
+      || !inside (header->names, header->names_size, 1, map->size)
+      || (header->names_size > 0 && names[header->names_size - 1] != 0))
+    goto invalid;
+
+  for (i = 0; i < header->areas; i++)
+    if (area[i].end < area[i].start
+	|| (area[i].data & 7) != 0
+	|| !inside (area[i].data, area[i].end - area[i].start,
+		    sizeof (word_t), map->size))
+      goto invalid;
+  for (i = 0; i < header->symbols; i++)
+    if (symbol[i].name >= header->names_size)
+      goto invalid;
+
+  fwrite (base + header->text, 1, header->text_size, output_file);
+  for (i = 0; i < header->areas; i++)
+    add_memory (memory, area[i].start, area[i].end - area[i].start,
+		(word_t *)(base + area[i].data));
+  for (i = 0; i < header->symbols; i++)
+    add_symbol (names + symbol[i].name, symbol[i].value, symbol[i].flags);
+
+  return 0;
+
+ invalid:
+  close_cache (map);
+  return -1;
+}
+
+static void
+pad (FILE *f, unsigned long long n)
+{
+  static const char zero[8];
+
+  fwrite (zero, 1, ALIGN (n) - n, f);
+}
+
+/* Write a cache file for the loaded memory and symbols, and the text
+   printed while loading.  It's written under another name first, so a
+   reader never sees a partial file. */
+void
+write_cache (const char *path, unsigned long long key,
+	     const char *text, size_t size, struct pdp10_memory *memory)
+{
+  struct cache_header header;
+  struct cache_area area;
+  struct cache_symbol symbol;
+  const struct symbol *symbols;
+  unsigned long long names, data;
+  char *temporary;
+  int i, n, fd, error;
+  FILE *f;
+
+  n = get_symbols (&symbols);
+  names = 0;
+  for (i = 0; i < n; i++)
+    names += strlen (symbols[i].name) + 1;
+
+  memset (&header, 0, sizeof header);
+  memcpy (header.magic, CACHE_MAGIC, 4);
+  header.version = CACHE_VERSION;
+  header.key = key;
+  header.text = sizeof header;
+  header.text_size = size;
+  header.area = header.text + ALIGN (size);
+  header.areas = memory->areas;
+  header.symbol = header.area + memory->areas * sizeof area;
+  header.symbols = n;
+  header.names = header.symbol + n * sizeof symbol;
+  header.names_size = names;
+  data = header.names + ALIGN (names);
+
+  temporary = malloc (strlen (path) + 8);
+  if (temporary == NULL)
+    {
+      fprintf (stderr, "Out of memory\n");
+      exit (1);
+    }
+  sprintf (temporary, "%s.XXXXXX", path);
+  fd = mkstemp (temporary);
+  f = fd == -1 ? NULL : fdopen (fd, "wb");
+  if (f == NULL)
+    {
+      fprintf (stderr, "Error writing cache %s: %s\n", path,
+	       strerror (errno));
+      if (fd != -1)
+	{
+	  close (fd);
+	  remove (temporary);
+	}
+      free (temporary);
+      return;
+    }
+
+  fwrite (&header, sizeof header, 1, f);
+  fwrite (text, 1, size, f);
+  pad (f, size);
+
+  for (i = 0; i < memory->areas; i++)
+    {
+      area.start = memory->area[i].start;
+      area.end = memory->area[i].end;
+      area.data = data;
+      fwrite (&area, sizeof area, 1, f);
+      data += (area.end - area.start) * sizeof (word_t);
+    }
+
+  names = 0;
+  for (i = 0; i < n; i++)
+    {
+      symbol.name = names;
+      symbol.value = symbols[i].value;
+      symbol.flags = symbols[i].flags;
+      fwrite (&symbol, sizeof symbol, 1, f);
+      names += strlen (symbols[i].name) + 1;
+    }
+  for (i = 0; i < n; i++)
+    fwrite (symbols[i].name, 1, strlen (symbols[i].name) + 1, f);
+  pad (f, names);
+
+  for (i = 0; i < memory->areas; i++)
+    fwrite (memory->area[i].data, sizeof (word_t),
+	    memory->area[i].end - memory->area[i].start, f);
+
+  error = ferror (f);
+  if (fclose (f) != 0 || error || rename (temporary, path) != 0)
+    {
+      fprintf (stderr, "Error writing cache %s: %s\n", path,
+	       strerror (errno));
+      remove (temporary);
+    }
+  free (temporary);
+}
+
+void
+close_cache (struct cache_map *map)
+{
+  if (map->base != NULL)
+    munmap (map->base, map->size);
+  map->base = NULL;
+  map->size = 0;
+}
@@ -0,0 +1,41 @@
+/* Copyright (C) 2026 Lars Brinkhoff <lars@nocrew.org>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdio.h>
+
+#include "dis.h"
+
+/* A cache file mapped into memory.  The memory areas loaded from it
+   point into the mapping. */
+struct cache_map
+{
+  void *base;
+  size_t size;
+};
+
+extern char *	cache_path (const char *dir, FILE *f, const char *options,
+			    unsigned long long *key);
+extern int	read_cache (const char *path, unsigned long long key,
+			    struct pdp10_memory *memory,
+			    struct cache_map *map);
+extern void	write_cache (const char *path, unsigned long long key,
+			     const char *text, size_t size,
+			     struct pdp10_memory *memory);
+extern void	close_cache (struct cache_map *map);
+
+#endif
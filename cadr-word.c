@@ -37,5 +37,7 @@ struct word_format cadr_word_format = {
   NULL,
   NULL,
   write_cadr_word,
+  NULL,
+  NULL,
   NULL
 };
@@ -0,0 +1,49 @@
+/* Copyright (C) 2026 Lars Brinkhoff <lars@nocrew.org>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include "dis.h"
+#include "symbols.h"
+
+/* Make a context with the same defaults as the one each thread
+   starts out with. */
+struct dis10_context *
+dis10_new (void)
+{
+  static const struct dis10_context init = DIS10_CONTEXT_INIT;
+  struct dis10_context *context;
+
+  context = malloc (sizeof *context);
+  if (context == NULL)
+    {
+      fprintf (stderr, "Out of memory\n");
+      exit (1);
+    }
+
+  *context = init;
+  return context;
+}
+
+void
+dis10_free (struct dis10_context *context)
+{
+  if (context == NULL)
+    return;
+
+  free_symbol_table (context->symbols);
+  free (context->decode_table);
+  free (context->input.buffer);
+  free (context->output.buffer);
+  free (context);
+}
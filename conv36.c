@@ -21,11 +21,12 @@
 #include <unistd.h>
 
 #include "dis.h"
+#include "stats.h"
 
 static void
 usage (char **argv)
 {
-  fprintf (stderr, "Usage: %s [-b] [-t] [-W<input word format>] [-X<output word format>] [<input file>]\n\n", argv[0]);
+  fprintf (stderr, "Usage: %s [-b] [-t] [-W<input word format>] [-X<output word format>] [--stats[=json]] [<input file>]\n\n", argv[0]);
   usage_word_format ();
   exit (1);
 }
@@ -73,10 +74,13 @@ main (int argc, char **argv)
 {
   FILE *file;
   int opt;
-  word_t word;
+  word_t buffer[1024];
   word_t mask = WORDMASK;
+  int i, n;
 
   default_formats (argv[0]);
+  if (parse_stats_option (&argc, argv))
+    usage (argv);
 
   while ((opt = getopt (argc, argv, "btW:X:")) != -1)
     {
@@ -118,9 +122,15 @@ main (int argc, char **argv)
   else
     usage (argv);
 
-  while ((word = get_word (file)) != -1)
-    write_word (stdout, word & mask);
+  stats_phase ("convert");
+  while ((n = get_words (file, buffer, 1024)) > 0)
+    {
+      for (i = 0; i < n; i++)
+	buffer[i] &= mask;
+      write_words (stdout, buffer, n);
+    }
   flush_word (stdout);
+  stats_file (file);
 
   if (file != stdin)
     fclose (file);
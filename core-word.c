@@ -41,6 +41,12 @@ get_core_word (FILE *f)
   return word;
 }
 
+static int
+get_core_words (FILE *f, word_t *buffer, int n)
+{
+  return get_fixed_words (f, buffer, n, 5, unpack_core_words);
+}
+
 void
 write_core_word (FILE *f, word_t word)
 {
@@ -51,10 +57,28 @@ write_core_word (FILE *f, word_t word)
   fputc ( word        & 0x0F, f);
 }
 
+static void
+write_core_words (FILE *f, const word_t *buffer, int n)
+{
+  unsigned char data[5 * 1024];
+  int m;
+
+  while (n > 0)
+    {
+      m = n > 1024 ? 1024 : n;
+      pack_core_words (buffer, data, m);
+      fwrite (data, 1, 5 * m, f);
+      buffer += m;
+      n -= m;
+    }
+}
+
 struct word_format core_word_format = {
   "core",
   get_core_word,
   NULL,
   write_core_word,
-  NULL
+  NULL,
+  get_core_words,
+  write_core_words
 };
@@ -19,14 +19,18 @@
 
 #include "dis.h"
 
+#if defined (__GNUC__) && defined (__x86_64__)
+#define SCRAMBLE_X86 1
+#include <immintrin.h>
+#endif
+
 #define BITMASK(width) ((1LL << (width)) - 1)
 #define FIELD(pos, width, value) (((value) >> (pos)) & BITMASK (width))
 
-static word_t random_seed;
-
 static word_t
-get_random (void)
+get_random (word_t *seed)
 {
+  word_t random_seed = *seed;
   word_t exp, frac, half;
 
   /* This is the same RNG used by SPCWAR! It returns an 18-bit result,
@@ -63,6 +67,7 @@ get_random (void)
 
   /* Pack it back together. */
   random_seed = ((exp & BITMASK (8)) << 27) | (frac & BITMASK (27));
+  *seed = random_seed;
 
   /* TSC B,B - XOR the two halves together to give the result. */
   half = (random_seed >> 18) ^ (random_seed & BITMASK (18));
@@ -79,34 +84,51 @@ typedef enum
    NUM_STEPS,
   } scramble_t;
 
+/* SCRAMBLE_ROTATE shift size when encrypting.  It's the square of
+   the password mod 64, negated if the password is odd, mod 36, so it
+   only depends on the low six bits. */
+static const word_t rotate_table[64] = {
+   0, 35,  4, 27, 16, 11,  0, 23,
+   0, 19,  0, 15, 16, 31,  4,  3,
+   0,  3,  4, 31, 16, 15,  0, 19,
+   0, 23,  0, 11, 16, 27,  4, 35,
+   0, 35,  4, 27, 16, 11,  0, 23,
+   0, 19,  0, 15, 16, 31,  4,  3,
+   0,  3,  4, 31, 16, 15,  0, 19,
+   0, 23,  0, 11, 16, 27,  4, 35,
+};
+
 static int
-scramble_step_compare (const void *a, const void *b)
+rotate_shift (int decrypt, word_t password)
 {
-  /* When encrypting, the largest order goes first. */
-  word_t a_order = *((word_t *) a);
-  word_t b_order = *((word_t *) b);
-  if (a_order < b_order)
-    return 1;
-  else if (a_order == b_order)
-    return 0;
-  else
-    return -1;
+  int shift_size = rotate_table[password & 077];
+
+  if (decrypt)
+    shift_size = 36 - shift_size;
+  return shift_size;
 }
 
+/* Compute everything which depends only on the password. */
 void
-scramble (int decrypt, int verbose, word_t password, const word_t *input, word_t *output, int count)
+scramble_schedule (struct scramble_key *key, int decrypt, word_t password)
 {
+  word_t *steps = key->steps;
+  word_t random_seed, word;
   int i, j;
-  int shift_size = 0;
-  word_t steps[NUM_STEPS];
-  word_t word;
 
-  /* Decide what order to do the possible scrambling operations in. */
+  key->password = password;
+  key->decrypt = decrypt;
+
+  /* Decide what order to do the possible scrambling operations in.
+     When encrypting, the largest order goes first.  The orders are
+     distinct, since the step number is in the low bits. */
   for (i = 0; i < NUM_STEPS; i++)
     {
-      steps[i] = (FIELD (27 - (9 * i), 8, password) << 18) | i;
+      word = (FIELD (27 - (9 * i), 8, password) << 18) | i;
+      for (j = i; j > 0 && steps[j - 1] < word; j--)
+	steps[j] = steps[j - 1];
+      steps[j] = word;
     }
-  qsort (steps, NUM_STEPS, sizeof (*steps), scramble_step_compare);
   if (decrypt)
     {
       /* Reverse the order. */
@@ -150,16 +172,57 @@ scramble (int decrypt, int verbose, word_t password, const word_t *input, word_t
     random_seed <<= 1;
   if (FIELD (021, 1, password))
     random_seed = (-random_seed) & WORDMASK;
+  key->seed = random_seed;
 
-  /* Compute SCRAMBLE_ROTATE shift size. */
-  shift_size = (password * password) & 077;
-  if (FIELD (0, 1, password))
-    shift_size *= -1;
-  while (shift_size < 0)
-    shift_size += 36;
-  shift_size %= 36;
-  if (decrypt)
-    shift_size = 36 - shift_size;
+  key->shift = rotate_shift (decrypt, password);
+}
+
+/* Scramble or unscramble one word.  The seed starts out as key->seed,
+   and is updated for the next word. */
+word_t
+scramble_word (const struct scramble_key *key, word_t *seed, word_t word)
+{
+  int shift_size = key->shift;
+  int j;
+
+  if (!key->decrypt)
+    word ^= get_random (seed);
+
+  for (j = 0; j < NUM_STEPS; j++)
+    switch (key->steps[j] & BITMASK (18))
+      {
+      case SCRAMBLE_COMPLEMENT:
+	word = (~word) & WORDMASK;
+	break;
+      case SCRAMBLE_SWAP:
+	word = ((word >> 18) & BITMASK(18)) | ((word & BITMASK (18)) << 18);
+	break;
+      case SCRAMBLE_XOR:
+	word ^= key->password;
+	break;
+      case SCRAMBLE_ROTATE:
+	word = (FIELD (0, 36 - shift_size, word) << shift_size)
+	  | FIELD (36 - shift_size, shift_size, word);
+	break;
+      default:
+	break;
+      }
+
+  if (key->decrypt)
+    word ^= get_random (seed);
+
+  return word;
+}
+
+void
+scramble (int decrypt, int verbose, word_t password, const word_t *input, word_t *output, int count)
+{
+  struct scramble_key key;
+  word_t random_seed;
+  int i;
+
+  scramble_schedule (&key, decrypt, password);
+  random_seed = key.seed;
 
   if (verbose)
     {
@@ -168,41 +231,354 @@ scramble (int decrypt, int verbose, word_t password, const word_t *input, word_t
       fprintf (stderr, "RAN/ %012llo\n", random_seed);
       for (i = 0; i < NUM_STEPS; i++)
         {
-          fprintf (stderr, "X%d/  %012llo\n", i + 1, steps[i]);
+          fprintf (stderr, "X%d/  %012llo\n", i + 1, key.steps[i]);
         }
     }
 
   for (i = 0; i < count; i++)
+    output[i] = scramble_word (&key, &random_seed, input[i]);
+}
+
+/* Scramble or unscramble the same word with many consecutive
+   passwords, which is what unscr needs to reject most of them.  The
+   word is taken to be at the given index in the file.
+
+   Within an aligned block of 256 passwords, only the low eight bits
+   change.  Those decide where SCRAMBLE_ROTATE comes in the order of
+   steps, so the block splits into at most four runs with the same
+   order.  The other steps are enabled or not for the whole block, and
+   the seed goes up or down by a fixed step from one password to the
+   next.  The vector kernels do a run several passwords at a time,
+   with only the seed and shift differing between lanes. */
+
+/* Return how many passwords from this one on have the same order. */
+static int
+run_length (word_t password)
+{
+  int low = FIELD (0, 8, password);
+  int end = 256;
+  int i, f;
+
+  /* SCRAMBLE_ROTATE comes before step i when low >= f. */
+  for (i = 0; i < NUM_STEPS - 1; i++)
+    {
+      f = FIELD (27 - (9 * i), 8, password);
+      if (f > low && f < end)
+	end = f;
+    }
+
+  return end - low;
+}
+
+/* The change in seed from one password in a run to the next. */
+static word_t
+seed_step (word_t password)
+{
+  word_t step;
+
+  if (FIELD (032, 1, password))
+    return 0;
+  step = FIELD (010, 1, password) ? 1 : 2;
+  return FIELD (021, 1, password) ? -step : step;
+}
+
+static void
+keys_scalar (const struct scramble_key *key, int n, int index,
+	     word_t word, word_t *output)
+{
+  struct scramble_key k = *key;
+  word_t step = seed_step (key->password);
+  word_t seed;
+  int i, j;
+
+  for (i = 0; i < n; i++)
+    {
+      k.password = key->password + i;
+      k.shift = rotate_shift (key->decrypt, k.password);
+      seed = (key->seed + i * step) & WORDMASK;
+      for (j = 0; j < index; j++)
+	get_random (&seed);
+      output[i] = scramble_word (&k, &seed, word);
+    }
+}
+
+#ifdef SCRAMBLE_X86
+
+/* The fraction is squared as a magnitude of at most 2^27, which
+   _mm256_mul_epu32 can do.  A square of exactly 2^54 never normalises
+   in FMPB and ends up as zero.  Otherwise, normalise by shifting in
+   halving steps. */
+__attribute__ ((target ("avx2")))
+static __m256i
+random_avx2 (__m256i *seed)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  __m256i s = *seed;
+  __m256i exp, frac, neg, sq, c, half;
+  int k;
+
+  exp = _mm256_sub_epi64 (_mm256_and_si256 (_mm256_srli_epi64 (s, 27),
+					    _mm256_set1_epi64x (0377)),
+			  _mm256_set1_epi64x (0200));
+  frac = _mm256_and_si256 (s, _mm256_set1_epi64x (BITMASK (27)));
+  neg = _mm256_sub_epi64 (zero, _mm256_srli_epi64 (s, 35));
+  exp = _mm256_xor_si256 (exp, _mm256_and_si256 (neg, _mm256_set1_epi64x (0377)));
+  frac = _mm256_blendv_epi8 (frac, _mm256_sub_epi64 (_mm256_set1_epi64x (1LL << 27),
+						     frac), neg);
+
+  exp = _mm256_add_epi64 (_mm256_add_epi64 (exp, exp), _mm256_set1_epi64x (0200));
+  sq = _mm256_mul_epu32 (frac, frac);
+  sq = _mm256_andnot_si256 (_mm256_cmpgt_epi64 (sq, _mm256_set1_epi64x (BITMASK (54))),
+			    sq);
+
+  for (k = 32; k > 0; k /= 2)
     {
-      word = input[i];
+      c = _mm256_andnot_si256 (_mm256_cmpeq_epi64 (sq, zero),
+			       _mm256_cmpgt_epi64 (_mm256_set1_epi64x (1LL << (54 - k)),
+						   sq));
+      sq = _mm256_blendv_epi8 (sq, _mm256_slli_epi64 (sq, k), c);
+      exp = _mm256_sub_epi64 (exp, _mm256_and_si256 (c, _mm256_set1_epi64x (k)));
+    }
+  frac = _mm256_srli_epi64 (sq, 27);
+  exp = _mm256_andnot_si256 (_mm256_cmpeq_epi64 (frac, zero), exp);
 
-      if (!decrypt)
-        word ^= get_random ();
+  s = _mm256_or_si256 (_mm256_slli_epi64 (_mm256_and_si256 (exp, _mm256_set1_epi64x (0377)), 27),
+		       _mm256_and_si256 (frac, _mm256_set1_epi64x (BITMASK (27))));
+  *seed = s;
+
+  half = _mm256_xor_si256 (_mm256_srli_epi64 (s, 18),
+			   _mm256_and_si256 (s, _mm256_set1_epi64x (BITMASK (18))));
+  return _mm256_or_si256 (_mm256_slli_epi64 (half, 18), half);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+keys_avx2 (const struct scramble_key *key, int n, int index,
+	   word_t word, word_t *output)
+{
+  const __m256i mask = _mm256_set1_epi64x (WORDMASK);
+  const __m256i half = _mm256_set1_epi64x (BITMASK (18));
+  word_t step = seed_step (key->password);
+  word_t p = key->password;
+  __m256i w, password, seed, shift;
+  int i, j;
+
+  for (i = 0; i + 4 <= n; i += 4, p += 4)
+    {
+      w = _mm256_set1_epi64x (word);
+      password = _mm256_add_epi64 (_mm256_set1_epi64x (p),
+				   _mm256_set_epi64x (3, 2, 1, 0));
+      seed = _mm256_add_epi64 (_mm256_set1_epi64x (key->seed + i * step),
+			       _mm256_set_epi64x (3 * step, 2 * step, step, 0));
+      seed = _mm256_and_si256 (seed, mask);
+      for (j = 0; j < index; j++)
+	random_avx2 (&seed);
+      shift = _mm256_i64gather_epi64 ((const long long *)rotate_table,
+				      _mm256_and_si256 (password,
+							_mm256_set1_epi64x (077)),
+				      8);
+      if (key->decrypt)
+	shift = _mm256_sub_epi64 (_mm256_set1_epi64x (36), shift);
+
+      if (!key->decrypt)
+	w = _mm256_xor_si256 (w, random_avx2 (&seed));
 
       for (j = 0; j < NUM_STEPS; j++)
-        switch (steps[j] & BITMASK (18))
-          {
-          case SCRAMBLE_COMPLEMENT:
-            word = (~word) & WORDMASK;
-            break;
-          case SCRAMBLE_SWAP:
-            word = ((word >> 18) & BITMASK(18)) | ((word & BITMASK (18)) << 18);
-            break;
-          case SCRAMBLE_XOR:
-            word ^= password;
-            break;
-          case SCRAMBLE_ROTATE:
-            word = (FIELD (0, 36 - shift_size, word) << shift_size)
-              | FIELD (36 - shift_size, shift_size, word);
-            break;
-          default:
-            break;
-          }
-
-      if (decrypt)
-        word ^= get_random ();
-
-      output[i] = word;
+	switch (key->steps[j] & BITMASK (18))
+	  {
+	  case SCRAMBLE_COMPLEMENT:
+	    w = _mm256_xor_si256 (w, mask);
+	    break;
+	  case SCRAMBLE_SWAP:
+	    w = _mm256_or_si256 (_mm256_and_si256 (_mm256_srli_epi64 (w, 18), half),
+				 _mm256_slli_epi64 (_mm256_and_si256 (w, half), 18));
+	    break;
+	  case SCRAMBLE_XOR:
+	    w = _mm256_xor_si256 (w, password);
+	    break;
+	  case SCRAMBLE_ROTATE:
+	    w = _mm256_or_si256 (_mm256_and_si256 (_mm256_sllv_epi64 (w, shift), mask),
+				 _mm256_srlv_epi64 (w, _mm256_sub_epi64 (_mm256_set1_epi64x (36),
+									 shift)));
+	    break;
+	  default:
+	    break;
+	  }
+
+      if (key->decrypt)
+	w = _mm256_xor_si256 (w, random_avx2 (&seed));
+
+      _mm256_storeu_si256 ((__m256i *)(output + i), w);
+    }
+
+  if (i < n)
+    {
+      struct scramble_key k = *key;
+      k.password = p;
+      k.seed = (key->seed + i * step) & WORDMASK;
+      keys_scalar (&k, n - i, index, word, output + i);
     }
 }
 
+/* With AVX-512, the fraction can be normalised in one step by
+   counting leading zeros. */
+__attribute__ ((target ("avx512f,avx512cd,avx512dq")))
+static __m512i
+random_avx512 (__m512i *seed)
+{
+  __m512i s = *seed;
+  __m512i exp, frac, sq, n, half;
+  __mmask8 neg;
+
+  exp = _mm512_sub_epi64 (_mm512_and_si512 (_mm512_srli_epi64 (s, 27),
+					    _mm512_set1_epi64 (0377)),
+			  _mm512_set1_epi64 (0200));
+  frac = _mm512_and_si512 (s, _mm512_set1_epi64 (BITMASK (27)));
+  neg = _mm512_test_epi64_mask (s, _mm512_set1_epi64 (1LL << 35));
+  exp = _mm512_mask_xor_epi64 (exp, neg, exp, _mm512_set1_epi64 (0377));
+  frac = _mm512_mask_sub_epi64 (frac, neg, _mm512_set1_epi64 (1LL << 27), frac);
+
+  exp = _mm512_add_epi64 (_mm512_add_epi64 (exp, exp), _mm512_set1_epi64 (0200));
+  sq = _mm512_mul_epu32 (frac, frac);
+  sq = _mm512_mask_mov_epi64 (sq, _mm512_cmpgt_epi64_mask (sq, _mm512_set1_epi64 (BITMASK (54))),
+			      _mm512_setzero_si512 ());
+
+  /* A zero fraction shifts by 54 and stays zero. */
+  n = _mm512_sub_epi64 (_mm512_lzcnt_epi64 (sq), _mm512_set1_epi64 (10));
+  sq = _mm512_sllv_epi64 (sq, n);
+  exp = _mm512_sub_epi64 (exp, n);
+  frac = _mm512_srli_epi64 (sq, 27);
+  exp = _mm512_maskz_mov_epi64 (_mm512_test_epi64_mask (frac, frac), exp);
+
+  s = _mm512_or_si512 (_mm512_slli_epi64 (_mm512_and_si512 (exp, _mm512_set1_epi64 (0377)), 27),
+		       _mm512_and_si512 (frac, _mm512_set1_epi64 (BITMASK (27))));
+  *seed = s;
+
+  half = _mm512_xor_si512 (_mm512_srli_epi64 (s, 18),
+			   _mm512_and_si512 (s, _mm512_set1_epi64 (BITMASK (18))));
+  return _mm512_or_si512 (_mm512_slli_epi64 (half, 18), half);
+}
+
+__attribute__ ((target ("avx512f,avx512cd,avx512dq")))
+static void
+keys_avx512 (const struct scramble_key *key, int n, int index,
+	     word_t word, word_t *output)
+{
+  const __m512i mask = _mm512_set1_epi64 (WORDMASK);
+  const __m512i half = _mm512_set1_epi64 (BITMASK (18));
+  const __m512i lane = _mm512_set_epi64 (7, 6, 5, 4, 3, 2, 1, 0);
+  word_t step = seed_step (key->password);
+  word_t p = key->password;
+  __m512i w, password, seed, shift;
+  int i, j;
+
+  for (i = 0; i + 8 <= n; i += 8, p += 8)
+    {
+      w = _mm512_set1_epi64 (word);
+      password = _mm512_add_epi64 (_mm512_set1_epi64 (p), lane);
+      seed = _mm512_add_epi64 (_mm512_set1_epi64 (key->seed + i * step),
+			       _mm512_mullo_epi64 (lane, _mm512_set1_epi64 (step)));
+      seed = _mm512_and_si512 (seed, mask);
+      for (j = 0; j < index; j++)
+	random_avx512 (&seed);
+      shift = _mm512_i64gather_epi64 (_mm512_and_si512 (password,
+							_mm512_set1_epi64 (077)),
+				      rotate_table, 8);
+      if (key->decrypt)
+	shift = _mm512_sub_epi64 (_mm512_set1_epi64 (36), shift);
+
+      if (!key->decrypt)
+	w = _mm512_xor_si512 (w, random_avx512 (&seed));
+
+      for (j = 0; j < NUM_STEPS; j++)
+	switch (key->steps[j] & BITMASK (18))
+	  {
+	  case SCRAMBLE_COMPLEMENT:
+	    w = _mm512_xor_si512 (w, mask);
+	    break;
+	  case SCRAMBLE_SWAP:
+	    w = _mm512_or_si512 (_mm512_and_si512 (_mm512_srli_epi64 (w, 18), half),
+				 _mm512_slli_epi64 (_mm512_and_si512 (w, half), 18));
+	    break;
+	  case SCRAMBLE_XOR:
+	    w = _mm512_xor_si512 (w, password);
+	    break;
+	  case SCRAMBLE_ROTATE:
+	    w = _mm512_or_si512 (_mm512_and_si512 (_mm512_sllv_epi64 (w, shift), mask),
+				 _mm512_srlv_epi64 (w, _mm512_sub_epi64 (_mm512_set1_epi64 (36),
+									 shift)));
+	    break;
+	  default:
+	    break;
+	  }
+
+      if (key->decrypt)
+	w = _mm512_xor_si512 (w, random_avx512 (&seed));
+
+      _mm512_storeu_si512 (output + i, w);
+    }
+
+  if (i < n)
+    {
+      struct scramble_key k = *key;
+      k.password = p;
+      k.seed = (key->seed + i * step) & WORDMASK;
+      keys_avx2 (&k, n - i, index, word, output + i);
+    }
+}
+
+#endif /* SCRAMBLE_X86 */
+
+static void (*keys) (const struct scramble_key *, int, int, word_t, word_t *);
+
+/* Choose the kernel for scramble_keys, at most the given BULK_ level.
+   Returns the level actually used. */
+int
+scramble_select (int level)
+{
+  keys = keys_scalar;
+
+#ifdef SCRAMBLE_X86
+  __builtin_cpu_init ();
+  if (level >= BULK_AVX512 && !(__builtin_cpu_supports ("avx512f")
+				&& __builtin_cpu_supports ("avx512cd")
+				&& __builtin_cpu_supports ("avx512dq")))
+    level = BULK_AVX2;
+  if (level >= BULK_AVX2 && !__builtin_cpu_supports ("avx2"))
+    level = BULK_SCALAR;
+  if (level < BULK_AVX2)
+    level = BULK_SCALAR;
+
+  if (level == BULK_AVX2)
+    keys = keys_avx2;
+  else if (level == BULK_AVX512)
+    keys = keys_avx512;
+#else
+  level = BULK_SCALAR;
+#endif
+
+  return level;
+}
+
+void
+scramble_keys (int decrypt, word_t password, int n, int index, word_t word,
+	       word_t *output)
+{
+  struct scramble_key key;
+  int run;
+
+  if (keys == NULL)
+    scramble_select (BULK_AVX512);
+
+  while (n > 0)
+    {
+      scramble_schedule (&key, decrypt, password);
+      run = run_length (password);
+      if (run > n)
+	run = n;
+      keys (&key, run, index, word, output);
+      password += run;
+      output += run;
+      n -= run;
+    }
+}
@@ -56,5 +56,7 @@ struct word_format data8_word_format = {
   get_data8_word,
   NULL,
   write_data8_word,
+  NULL,
+  NULL,
   NULL
 };
@@ -15,12 +15,16 @@
 
 #define _GNU_SOURCE /* for strcasestr */
 
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
+#include <sched.h>
 
 #include "opcode/pdp10.h"
 #include "dis.h"
 #include "memory.h"
+#include "stats.h"
 #include "symbols.h"
 #include "timing.h"
 
@@ -159,36 +163,151 @@ static struct its_oper opers[] =
   { ".netint",	0000111, HINT_CHANNEL },
 };
 
+/* Output line being rendered by format_word.  Characters past the end
+   of the buffer are counted but not stored. */
+struct line
+{
+  char *buffer;
+  int size;
+  int length;
+};
+
+static int
+put_char (struct line *line, int c)
+{
+  if (line->length < line->size)
+    line->buffer[line->length] = c;
+  line->length++;
+  return 1;
+}
+
+static int
+put_string (struct line *line, const char *string)
+{
+  const char *p;
+
+  for (p = string; *p; p++)
+    put_char (line, *p);
+
+  return p - string;
+}
+
+/* Print a mnemonic left justified in a nine character field. */
+static int
+put_name (struct line *line, const char *name)
+{
+  int n = put_string (line, name);
+
+  do
+    n += put_char (line, ' ');
+  while (n < 9);
+
+  return n;
+}
+
+/* Print an octal number, zero padded to at least digits positions. */
 static int
-spaces (int n)
+put_octal (struct line *line, word_t value, int digits)
+{
+  char tmp[24];
+  int i = 0, n;
+
+  do
+    {
+      tmp[i++] = '0' + (value & 7);
+      value = (unsigned long long)value >> 3;
+    }
+  while (value != 0);
+
+  while (i < digits)
+    tmp[i++] = '0';
+
+  n = i;
+  while (i > 0)
+    put_char (line, tmp[--i]);
+
+  return n;
+}
+
+static int
+spaces (struct line *line, int n)
 {
   int i;
 
   for (i = 0; i < n; i++)
-    putchar (' ');
+    put_char (line, ' ');
 
   return i < 0 ? 0 : i;
 }
 
-static const struct pdp10_instruction *
-lookup (word_t word, int cpu_model)
+/* Opcode decoding table, indexed by the 13-bit opcode and A fields.
+   It's built from pdp10_instruction[] the first time a word is
+   decoded for a particular CPU model.  Since the opcode table must
+   be scanned linearly, the first matching entry wins each slot.
+   Each context has its own table. */
+#define DECODE_SIZE	(1 << 13)
+#define DECODE_INDEX(word)	(OPCODE_A (word) >> 2)
+
+static void
+decode_slot (const struct pdp10_instruction **table, int index,
+	     const struct pdp10_instruction *op)
 {
-  int i, opcode;
+  if (table[index] == NULL)
+    table[index] = op;
+}
+
+static void
+build_decode_table (int cpu_model)
+{
+  const struct pdp10_instruction **table = dis10->decode_table;
+  const struct pdp10_instruction *op;
+  int i, j;
+
+  if (table == NULL)
+    {
+      table = malloc (DECODE_SIZE * sizeof *table);
+      if (table == NULL)
+	{
+	  fprintf (stderr, "Out of memory\n");
+	  exit (1);
+	}
+      dis10->decode_table = table;
+    }
+  for (i = 0; i < DECODE_SIZE; i++)
+    table[i] = NULL;
 
   for (i = 0; i < pdp10_num_instructions; i++)
     {
-      if (pdp10_instruction[i].type & PDP10_A_OPCODE)
-	opcode = OPCODE_A (word);
-      else if (pdp10_instruction[i].type & PDP10_IO)
-	opcode = OPCODE_A (word) & 070034;
+      op = &pdp10_instruction[i];
+      if (!(op->model & cpu_model))
+	continue;
+
+      if (op->type & PDP10_A_OPCODE)
+	decode_slot (table, op->opcode >> 2, op);
+      else if (op->type & PDP10_IO)
+	{
+	  /* Any device code. */
+	  for (j = 0; j < 0200; j++)
+	    decode_slot (table, (op->opcode | (j << 5)) >> 2, op);
+	}
       else
-	opcode = OPCODE (word);
-      if (opcode == pdp10_instruction[i].opcode &&
-	  (pdp10_instruction[i].model & cpu_model))
-	return &pdp10_instruction[i];
+	{
+	  /* Any A field. */
+	  for (j = 0; j < 020; j++)
+	    decode_slot (table, (op->opcode << 4) | j, op);
+	}
     }
 
-  return NULL;
+  dis10->decode_model = cpu_model;
+}
+
+static const struct pdp10_instruction *
+lookup (word_t word, int cpu_model)
+{
+  if (cpu_model != dis10->decode_model)
+    build_decode_table (cpu_model);
+
+  return dis10->decode_table[DECODE_INDEX (word)];
 }
 
 static const struct pdp10_device *
@@ -223,45 +342,757 @@ lookup_oper (word_t word)
   return NULL;
 }
 
-int
-calc_e (struct pdp10_memory *memory, word_t word)
+/* Effective addresses of indirect words, by address, for each
+   thread.  Entries from another memory generation are free. */
+#define EFFECTIVE_SIZE 4096
+
+struct effective
 {
+  int generation;
+  int address;
+  int e;
+};
+
+static __thread struct effective effective[EFFECTIVE_SIZE];
+
+/* Compute the effective address of the word at address, following
+   indirection.  Return -1 if it's indexed, or if the chain loops.  A
+   loop is found with Brent's algorithm and reported for the address
+   the chain started from, so a loop reached from several addresses is
+   reported for each of them, and again when the table has dropped the
+   entry. */
+static int
+indirect_e (struct pdp10_memory *memory, int address)
+{
+  struct effective *slot = &effective[address % EFFECTIVE_SIZE];
+  struct effective *hit;
+  int tortoise = address, power = 1, steps = 0;
+  int a = address;
+  word_t word;
   int e;
 
+  if (slot->generation == memory->generation && slot->address == address)
+    return slot->e;
+
   for (;;)
     {
-      if (X (word) != 0)
-	return -1;
+      hit = &effective[a % EFFECTIVE_SIZE];
+      if (a != address
+	  && hit->generation == memory->generation && hit->address == a)
+	{
+	  e = hit->e;
+	  break;
+	}
 
-      e = Y (word);
+      word = get_word_at (memory, a);
+      if (X (word) != 0)
+	{
+	  e = -1;
+	  break;
+	}
       if (!I (word))
-	break;
+	{
+	  e = Y (word);
+	  break;
+	}
 
-      word = get_word_at (memory, e);
+      a = Y (word);
+      if (a == tortoise)
+	{
+	  STATS_ADD (STATS_LOOPS, 1);
+	  fprintf (stderr, "Indirection loop at %06o\n", address);
+	  e = -1;
+	  break;
+	}
+      if (++steps == power)
+	{
+	  tortoise = a;
+	  power *= 2;
+	  steps = 0;
+	}
     }
-  
+
+  slot->generation = memory->generation;
+  slot->address = address;
+  slot->e = e;
   return e;
 }
 
+int
+calc_e (struct pdp10_memory *memory, word_t word)
+{
+  if (X (word) != 0)
+    return -1;
+  if (!I (word))
+    return Y (word);
+  return indirect_e (memory, Y (word));
+}
+
+static void list_record (FILE *f, struct pdp10_memory *memory, word_t word,
+			 int address, int cpu_model);
+
+static void
+dis_word (FILE *f, struct pdp10_memory *memory, word_t word,
+	  int address, int cpu_model)
+{
+  STATS_ADD (STATS_INSTRUCTIONS, 1);
+  if (dis10->listing_format != LISTING_TEXT)
+    {
+      list_record (f, memory, word, address, cpu_model);
+      return;
+    }
+  if (word & START_FILE)
+    fprintf (f, "Start of file.\n");
+  else if (word & START_RECORD)
+    fprintf (f, "Start of record.\n");
+  fdisassemble_word (f, memory, word & WORDMASK, address, cpu_model);
+}
+
+/* Optionally, a run of copies of a word at consecutive addresses is
+   shown as the first word and a count of the rest.  Runs are broken
+   at areas and pages, so parallel disassembly can render each page on
+   its own, and at symbols, so no label is lost. */
+struct repeat
+{
+  word_t word;
+  int address;
+  int count;
+};
+
+static void
+end_repeat (FILE *f, struct repeat *r, struct pdp10_memory *memory,
+	    int cpu_model)
+{
+  if (r->count == 1)
+    dis_word (f, memory, r->word, r->address + 1, cpu_model);
+  else if (r->count > 1)
+    fprintf (f, "         (repeated %d times)\n", r->count);
+  r->count = -1;
+}
+
+static void
+dis_repeat (FILE *f, struct repeat *r, struct pdp10_memory *memory,
+	    word_t word, int address, int cpu_model)
+{
+  if (!dis10->collapse || dis10->listing_format != LISTING_TEXT)
+    {
+      dis_word (f, memory, word, address, cpu_model);
+      return;
+    }
+
+  if (r->count >= 0
+      && word == r->word
+      && address == r->address + r->count + 1
+      && address % ITS_PAGESIZE != 0
+      && get_symbol_by_value (address, HINT_ADDRESS) == NULL)
+    {
+      r->count++;
+      return;
+    }
+
+  end_repeat (f, r, memory, cpu_model);
+  dis_word (f, memory, word, address, cpu_model);
+  r->word = word;
+  r->address = address;
+  r->count = 0;
+}
+
+/* Disassemble the words from start up to, but not including, end. */
 void
-dis (struct pdp10_memory *memory, int cpu_model)
+dis_range (struct pdp10_memory *memory, int start, int end, int cpu_model)
 {
-  word_t mask = 0777777777777LL;
+  struct repeat r = { 0, 0, -1 };
   word_t word;
 
-  set_address (memory, -1);
-  while ((word = get_next_word (memory)) != -1)
+  if (seek_address (memory, start) == -1)
+    return;
+  while ((word = get_next_word (memory)) != -1
+	 && get_address (memory) < end)
     {
-      if (word & START_FILE)
-	printf ("Start of file.\n");
-      else if (word & START_RECORD)
-	printf ("Start of record.\n");
-      disassemble_word (memory, word & mask, get_address (memory), cpu_model);
+      if (get_address (memory) == memory->current_area->start)
+	end_repeat (output_file, &r, memory, cpu_model);
+      dis_repeat (output_file, &r, memory, word, get_address (memory),
+		  cpu_model);
     }
+  end_repeat (output_file, &r, memory, cpu_model);
 }
 
-int
-print_val (const char *format, int field, int hint)
+void
+dis (struct pdp10_memory *memory, int cpu_model)
+{
+  dis_range (memory, 0, INT_MAX, cpu_model);
+}
+
+/* Parallel disassembly.  The memory areas are cut into chunks of at
+   most a page, aligned to pages, which worker threads render into
+   private buffers.  The calling thread writes the buffers to the
+   output in address order, so the output is the same as from dis. */
+
+struct dis_chunk
+{
+  struct pdp10_area *area;
+  int start;
+  int end;
+  char *text;
+  size_t size;
+  int done;
+};
+
+struct dis_work
+{
+  struct dis10_context *context;
+  struct pdp10_memory *memory;
+  int cpu_model;
+  struct dis_chunk *chunk;
+  int chunks;
+  int next;
+  pthread_mutex_t lock;
+  pthread_cond_t done;
+};
+
+static void *
+dis_worker (void *arg)
+{
+  struct dis_work *work = arg;
+  struct dis_chunk *chunk;
+  struct repeat r;
+  int address;
+  FILE *f;
+
+  dis10_use (work->context);
+
+  for (;;)
+    {
+      pthread_mutex_lock (&work->lock);
+      if (work->next == work->chunks)
+	{
+	  pthread_mutex_unlock (&work->lock);
+	  return NULL;
+	}
+      chunk = &work->chunk[work->next++];
+      pthread_mutex_unlock (&work->lock);
+
+      f = open_memstream (&chunk->text, &chunk->size);
+      if (f == NULL)
+	{
+	  fprintf (stderr, "Out of memory\n");
+	  exit (1);
+	}
+      r.count = -1;
+      for (address = chunk->start; address < chunk->end; address++)
+	dis_repeat (f, &r, work->memory,
+		    chunk->area->data[address - chunk->area->start],
+		    address, work->cpu_model);
+      end_repeat (f, &r, work->memory, work->cpu_model);
+      fclose (f);
+
+      pthread_mutex_lock (&work->lock);
+      chunk->done = 1;
+      pthread_cond_broadcast (&work->done);
+      pthread_mutex_unlock (&work->lock);
+    }
+}
+
+void
+dis_parallel (struct pdp10_memory *memory, int cpu_model, int jobs)
+{
+  struct dis_work work;
+  struct pdp10_area *area;
+  pthread_t *thread;
+  int i, address;
+
+  work.chunks = 0;
+  work.next = 0;
+  for (i = 0; i < memory->areas; i++)
+    {
+      area = &memory->area[i];
+      if (area->end > area->start)
+	work.chunks += (area->end - 1) / ITS_PAGESIZE
+		       - area->start / ITS_PAGESIZE + 1;
+    }
+
+  /* More threads than chunks would only sit idle. */
+  if (jobs > work.chunks)
+    jobs = work.chunks;
+  if (jobs <= 1)
+    {
+      dis (memory, cpu_model);
+      return;
+    }
+
+  work.context = dis10;
+  work.memory = memory;
+  work.cpu_model = cpu_model;
+  work.chunk = calloc (work.chunks, sizeof (struct dis_chunk));
+  thread = malloc (jobs * sizeof (pthread_t));
+  if ((work.chunk == NULL && work.chunks > 0) || thread == NULL)
+    {
+      fprintf (stderr, "Out of memory\n");
+      exit (1);
+    }
+
+  work.chunks = 0;
+  for (i = 0; i < memory->areas; i++)
+    {
+      area = &memory->area[i];
+      for (address = area->start; address < area->end;
+	   address = work.chunk[work.chunks - 1].end)
+	{
+	  work.chunk[work.chunks].area = area;
+	  work.chunk[work.chunks].start = address;
+	  work.chunk[work.chunks].end
+	    = (address / ITS_PAGESIZE + 1) * ITS_PAGESIZE;
+	  if (work.chunk[work.chunks].end > area->end)
+	    work.chunk[work.chunks].end = area->end;
+	  work.chunks++;
+	}
+    }
+
+  /* Build the opcode table and sort the symbols before starting the
+     workers, so that they only read shared state. */
+  lookup (0, cpu_model);
+  get_symbol_by_value (0, HINT_ADDRESS);
+
+  pthread_mutex_init (&work.lock, NULL);
+  pthread_cond_init (&work.done, NULL);
+
+  for (i = 0; i < jobs; i++)
+    {
+      if (pthread_create (&thread[i], NULL, dis_worker, &work) != 0)
+	{
+	  fprintf (stderr, "Error creating thread\n");
+	  exit (1);
+	}
+    }
+
+  for (i = 0; i < work.chunks; i++)
+    {
+      pthread_mutex_lock (&work.lock);
+      while (!work.chunk[i].done)
+	pthread_cond_wait (&work.done, &work.lock);
+      pthread_mutex_unlock (&work.lock);
+
+      fwrite (work.chunk[i].text, 1, work.chunk[i].size, output_file);
+      free (work.chunk[i].text);
+    }
+
+  for (i = 0; i < jobs; i++)
+    pthread_join (thread[i], NULL);
+
+  pthread_cond_destroy (&work.done);
+  pthread_mutex_destroy (&work.lock);
+  free (thread);
+  free (work.chunk);
+}
+
+/* Streaming disassembly, for files which need no global structure.
+   A reader thread gets pages of words from the file, a decoder thread
+   renders them, and the calling thread writes the text.  The stages
+   are connected by rings with one producer and one consumer each, so
+   they need no locks, except to sleep when a stage has waited for a
+   while.  The decoder keeps a window of pages around the one it
+   renders, so memory use doesn't depend on the size of the file.
+   Lookups in memory, as for a .call block, are served from the
+   window, reading ahead if need be.  A page outside the window is
+   read again from the file, starting from a mark the reader left
+   where the word format had nothing buffered.  The file must be
+   seekable. */
+
+#define RING_SLOTS	16
+#define RING_SPINS	64
+#define WINDOW_BEHIND	64
+#define WINDOW_AHEAD	64
+#define WINDOW_PAGES	(WINDOW_BEHIND + 1 + WINDOW_AHEAD)
+
+struct ring
+{
+  unsigned head;		/* Written by the producer. */
+  unsigned tail;		/* Written by the consumer. */
+  int waiting;			/* Set by a stage going to sleep. */
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+};
+
+struct stream_words
+{
+  int start;
+  int n;			/* Zero at the end. */
+  word_t word[ITS_PAGESIZE];
+};
+
+/* Where a page starts in the file. */
+struct stream_mark
+{
+  int page;
+  off_t offset;
+  struct word_stream input;
+};
+
+struct stream_text
+{
+  char *text;			/* NULL at the end. */
+  size_t size;
+};
+
+struct dis_stream
+{
+  struct dis10_context *context;
+  FILE *file;
+  struct pdp10_memory *memory;
+  int cpu_model;
+  int loaded;			/* Next address to read. */
+  int end;			/* Set when the input is exhausted. */
+  int page;			/* Page being rendered. */
+  int pages;			/* Pages read. */
+  int base;			/* Address of the first word. */
+  pthread_mutex_t file_lock;	/* For the file and the marks. */
+  int read;			/* Pages read by the reader. */
+  struct stream_mark *mark;
+  int marks;
+  int max_marks;
+  struct stream_words fetched;	/* Last page read again. */
+  struct ring in;
+  struct ring out;
+  struct stream_words words[RING_SLOTS];
+  struct stream_text text[RING_SLOTS];
+  struct stream_words window[WINDOW_PAGES];
+};
+
+static void
+ring_init (struct ring *r)
+{
+  r->head = r->tail = 0;
+  r->waiting = 0;
+  pthread_mutex_init (&r->lock, NULL);
+  pthread_cond_init (&r->changed, NULL);
+}
+
+static void
+ring_destroy (struct ring *r)
+{
+  pthread_mutex_destroy (&r->lock);
+  pthread_cond_destroy (&r->changed);
+}
+
+/* Wait for the other stage to move an index away from a value.  Spin
+   for a while, since it usually takes a moment, and then sleep until
+   woken by ring_moved. */
+static void
+ring_wait (struct ring *r, unsigned *index, unsigned value)
+{
+  int i;
+
+  for (i = 0; i < RING_SPINS; i++)
+    {
+      if (__atomic_load_n (index, __ATOMIC_ACQUIRE) != value)
+	return;
+      sched_yield ();
+    }
+
+  pthread_mutex_lock (&r->lock);
+  __atomic_store_n (&r->waiting, 1, __ATOMIC_SEQ_CST);
+  while (__atomic_load_n (index, __ATOMIC_SEQ_CST) == value)
+    pthread_cond_wait (&r->changed, &r->lock);
+  __atomic_store_n (&r->waiting, 0, __ATOMIC_SEQ_CST);
+  pthread_mutex_unlock (&r->lock);
+}
+
+/* Move an index, and wake the other stage if it's asleep. */
+static void
+ring_moved (struct ring *r, unsigned *index)
+{
+  __atomic_store_n (index, *index + 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n (&r->waiting, __ATOMIC_SEQ_CST))
+    {
+      pthread_mutex_lock (&r->lock);
+      pthread_cond_broadcast (&r->changed);
+      pthread_mutex_unlock (&r->lock);
+    }
+}
+
+/* Return the slot to fill next. */
+static unsigned
+ring_put (struct ring *r)
+{
+  ring_wait (r, &r->tail, r->head - RING_SLOTS);
+  return r->head % RING_SLOTS;
+}
+
+static void
+ring_push (struct ring *r)
+{
+  ring_moved (r, &r->head);
+}
+
+/* Return the slot to empty next. */
+static unsigned
+ring_get (struct ring *r)
+{
+  ring_wait (r, &r->head, r->tail);
+  return r->tail % RING_SLOTS;
+}
+
+static void
+ring_pop (struct ring *r)
+{
+  ring_moved (r, &r->tail);
+}
+
+static void *
+stream_reader (void *arg)
+{
+  struct dis_stream *s = arg;
+  struct stream_words *slot;
+
+  dis10_use (s->context);
+
+  do
+    {
+      slot = &s->words[ring_put (&s->in)];
+      pthread_mutex_lock (&s->file_lock);
+      if (dis10->input.buffer == NULL)
+	{
+	  if (s->marks == s->max_marks)
+	    {
+	      s->max_marks = s->max_marks == 0 ? 64 : 2 * s->max_marks;
+	      s->mark = realloc (s->mark, s->max_marks * sizeof *s->mark);
+	      if (s->mark == NULL)
+		{
+		  fprintf (stderr, "Out of memory\n");
+		  exit (1);
+		}
+	    }
+	  s->mark[s->marks].page = s->read;
+	  s->mark[s->marks].offset = ftello (s->file);
+	  s->mark[s->marks].input = dis10->input;
+	  s->marks++;
+	}
+      slot->n = get_words (s->file, slot->word, ITS_PAGESIZE);
+      s->read++;
+      pthread_mutex_unlock (&s->file_lock);
+      ring_push (&s->in);
+    }
+  while (slot->n > 0);
+
+  return NULL;
+}
+
+/* Move the next page from the reader into the window.  Return 0 at
+   the end of the input, or if the window is full. */
+static int
+stream_pull (struct dis_stream *s)
+{
+  struct stream_words *slot, *page;
+
+  if (s->end || s->pages - s->page > WINDOW_AHEAD)
+    return 0;
+
+  slot = &s->words[ring_get (&s->in)];
+  if (slot->n == 0)
+    s->end = 1;
+  else
+    {
+      page = &s->window[s->pages++ % WINDOW_PAGES];
+      page->start = s->loaded;
+      page->n = slot->n;
+      memcpy (page->word, slot->word, slot->n * sizeof (word_t));
+      s->loaded += slot->n;
+    }
+  ring_pop (&s->in);
+
+  return !s->end;
+}
+
+/* Read a page again into s->fetched, in a context of its own so the
+   reader's state isn't disturbed, and put the file back where the
+   reader left it.  Start from the last mark before the page, or from
+   where the reader is if it hasn't got that far. */
+static void
+stream_fetch (struct dis_stream *s, int page)
+{
+  struct dis10_context *context = dis10, scratch;
+  struct stream_mark *m;
+  off_t position;
+  size_t size;
+  int i, n;
+
+  pthread_mutex_lock (&s->file_lock);
+  position = ftello (s->file);
+  scratch = *context;
+  if (page >= s->read)
+    {
+      i = s->read;
+      if (context->input.buffer != NULL)
+	{
+	  size = context->input.words * sizeof (word_t);
+	  scratch.input.buffer = malloc (size);
+	  if (scratch.input.buffer == NULL)
+	    {
+	      fprintf (stderr, "Out of memory\n");
+	      exit (1);
+	    }
+	  memcpy (scratch.input.buffer, context->input.buffer, size);
+	}
+    }
+  else
+    {
+      for (m = &s->mark[s->marks - 1]; m->page > page; m--)
+	;
+      i = m->page;
+      scratch.input = m->input;
+      fseeko (s->file, m->offset, SEEK_SET);
+    }
+
+  dis10_use (&scratch);
+  for (;;)
+    {
+      n = get_words (s->file, s->fetched.word, ITS_PAGESIZE);
+      STATS_ADD (STATS_WORDS, -n);
+      if (i == page || n < ITS_PAGESIZE)
+	break;
+      i++;
+    }
+  free (scratch.input.buffer);
+  dis10_use (context);
+
+  fseeko (s->file, position, SEEK_SET);
+  pthread_mutex_unlock (&s->file_lock);
+
+  s->fetched.start = s->base + page * ITS_PAGESIZE;
+  s->fetched.n = i == page ? n : 0;
+}
+
+static word_t
+stream_load (struct pdp10_memory *memory, int address)
+{
+  struct dis_stream *s = memory->load_data;
+  struct stream_words *page;
+  int i;
+
+  if (address < s->base)
+    return -1;
+
+  while (address >= s->loaded)
+    if (!stream_pull (s))
+      break;
+
+  i = s->page > WINDOW_BEHIND ? s->page - WINDOW_BEHIND : 0;
+  for (; i < s->pages; i++)
+    {
+      page = &s->window[i % WINDOW_PAGES];
+      if (address >= page->start && address < page->start + page->n)
+	return page->word[address - page->start];
+    }
+
+  page = &s->fetched;
+  if (page->n == 0 || address < page->start
+      || address >= page->start + page->n)
+    stream_fetch (s, (address - s->base) / ITS_PAGESIZE);
+  if (address >= page->start && address < page->start + page->n)
+    return page->word[address - page->start];
+
+  return -1;
+}
+
+static void *
+stream_decoder (void *arg)
+{
+  struct dis_stream *s = arg;
+  struct stream_words *page;
+  struct stream_text *slot;
+  struct repeat r;
+  int address;
+  FILE *f;
+
+  dis10_use (s->context);
+
+  /* Pages may have been read ahead while rendering the one before. */
+  for (s->page = 0; s->page < s->pages || stream_pull (s); s->page++)
+    {
+      page = &s->window[s->page % WINDOW_PAGES];
+      slot = &s->text[ring_put (&s->out)];
+      f = open_memstream (&slot->text, &slot->size);
+      if (f == NULL)
+	{
+	  fprintf (stderr, "Out of memory\n");
+	  exit (1);
+	}
+      r.count = -1;
+      for (address = page->start; address < page->start + page->n;
+	   address++)
+	dis_repeat (f, &r, s->memory, page->word[address - page->start],
+		    address, s->cpu_model);
+      end_repeat (f, &r, s->memory, s->cpu_model);
+      fclose (f);
+      ring_push (&s->out);
+    }
+
+  slot = &s->text[ring_put (&s->out)];
+  slot->text = NULL;
+  ring_push (&s->out);
+
+  return NULL;
+}
+
+/* Disassemble the words in a seekable file, starting at an address,
+   without loading them into memory.  Areas already in memory are seen
+   by lookups, but not disassembled. */
+void
+dis_stream (FILE *f, struct pdp10_memory *memory, int address,
+	    int cpu_model)
+{
+  struct dis_stream *s;
+  struct stream_text *slot;
+  pthread_t reader, decoder;
+
+  s = calloc (1, sizeof *s);
+  if (s == NULL)
+    {
+      fprintf (stderr, "Out of memory\n");
+      exit (1);
+    }
+  s->context = dis10;
+  s->file = f;
+  s->memory = memory;
+  s->cpu_model = cpu_model;
+  s->loaded = address;
+  s->base = address;
+  pthread_mutex_init (&s->file_lock, NULL);
+  ring_init (&s->in);
+  ring_init (&s->out);
+  memory->load = stream_load;
+  memory->load_data = s;
+
+  if (pthread_create (&reader, NULL, stream_reader, s) != 0
+      || pthread_create (&decoder, NULL, stream_decoder, s) != 0)
+    {
+      fprintf (stderr, "Error creating thread\n");
+      exit (1);
+    }
+
+  for (;;)
+    {
+      slot = &s->text[ring_get (&s->out)];
+      if (slot->text == NULL)
+	break;
+      fwrite (slot->text, 1, slot->size, output_file);
+      free (slot->text);
+      ring_pop (&s->out);
+    }
+
+  pthread_join (decoder, NULL);
+  pthread_join (reader, NULL);
+  ring_destroy (&s->in);
+  ring_destroy (&s->out);
+  pthread_mutex_destroy (&s->file_lock);
+  memory->load = NULL;
+  memory->load_data = NULL;
+  free (s->mark);
+  free (s);
+}
+
+static int
+print_val (struct line *line, const char *format, int field, int hint)
 {
   const char *p;
   const struct symbol *sym;
@@ -275,13 +1106,13 @@ print_val (const char *format, int field, int hint)
 
 	  sym = get_symbol_by_value (field, hint);
 	  if (sym == NULL)
-	    n += printf ("%o", field);
+	    n += put_octal (line, field, 0);
 	  else
-	    n += printf ("%s", sym->name);
+	    n += put_string (line, sym->name);
 	}
       else
 	{
-	  n += printf ("%c", *p);
+	  n += put_char (line, *p);
 	}
     }
 
@@ -317,252 +1148,688 @@ static double immediate_float (word_t x)
   return (sign ? -1.0 : 1.0) * (double)fraction * exp;
 }
 
-void
-disassemble_word (struct pdp10_memory *memory, word_t word,
-		  int address, int cpu_model)
+/* Return nonzero if a word seems likely to be a printable string, and
+   its five ASCII characters in ch. */
+static int
+ascii_printable (word_t word, char *ch)
 {
-  const struct symbol *sym;
-  const struct pdp10_instruction *op;
-  int printable, hint;
-  char ch[5];
-  int i, n;
+  int printable = 1;
+  int seen_nonzero = 0;
+  int i;
 
-  sym = get_symbol_by_value (address, HINT_ADDRESS);
-  if (sym != NULL)
-    printf ("%s:\n", sym->name);
+  for (i = 0; i < 5; i++)
+    {
+      ch[i] = (word >> (((4 - i) * 7) + 1)) & 0177;
+      switch (ch[i])
+	{
+	case '\0':
+	case '\t':
+	case '\n':
+	case '\f':
+	case '\r':
+	case '\033':
+	  break;
+	default:
+	  if (ch[i] < 040 || ch[i] > 0176)
+	    printable = 0;
+	  break;
+	}
+    }
 
-  if (address == -1)
-    printf ("         ");
-  else
-    printf ("%06o:  ", address);
+  if ((word & 1) == 1 ||
+      word == 0 ||
+      word == POPJ_17)
+    printable = 0;
+
+  for (i = 4; i >= 0; i--)
+    {
+      if (ch[i] == 0)
+	{
+	  if (seen_nonzero)
+	    printable = 0;
+	}
+      else
+	seen_nonzero = 1;
+    }
+
+  return printable;
+}
 
-  printf ("%012llo  ", word);
+/* Return nonzero if a word seems likely to be a SIXBIT name: letters
+   and digits, and maybe trailing spaces. */
+static int
+sixbit_plausible (word_t word)
+{
+  int i, c, end = 0;
 
-  n = 0;
+  if (word == 0)
+    return 0;
+
+  for (i = 0; i < 6; i++)
+    {
+      c = (word >> (6 * (5 - i))) & 077;
+      if (c == 0)
+	end = 1;
+      else if (end || !((c >= 020 && c <= 031) || (c >= 041 && c <= 072)))
+	return 0;
+    }
+
+  return 1;
+}
+
+/* What an instruction word shows, apart from the word itself.  Both
+   the text listing and the records of a machine readable listing are
+   made from this. */
+enum { DECODED_DATA, DECODED_OPER, DECODED_CALL, DECODED_INSTRUCTION };
+
+struct decoded
+{
+  int kind;
+  const char *name;		/* Mnemonic, or NULL. */
+  int mnemonic;			/* Its number, from one, or 0. */
+  int a_hint;			/* Hint for A, or -1 if it's not shown. */
+  int io;			/* Shows a device instead of A. */
+  const struct pdp10_device *device;
+  int device_mnemonic;		/* Its number, or 0. */
+  int e;			/* Shows I, X, and Y. */
+  int y_hint;			/* Hint for Y, or -1 if it's not shown. */
+  int immediate_float;		/* Y is a float if it's not a symbol. */
+  int setz;			/* Address of a .call block, or -1. */
+};
+
+#define NUM_OPERS	(int)(sizeof opers / sizeof opers[0])
+
+/* Mnemonics are numbered from one: instructions, then ITS .opers,
+   then devices. */
+static int
+num_mnemonics (void)
+{
+  return pdp10_num_instructions + NUM_OPERS + pdp10_num_devices;
+}
+
+static const char *
+mnemonic_name (int i)
+{
+  if (i < pdp10_num_instructions)
+    return pdp10_instruction[i].name;
+  i -= pdp10_num_instructions;
+  if (i < NUM_OPERS)
+    return opers[i].name;
+  return pdp10_device[i - NUM_OPERS].name;
+}
+
+static void
+decode (struct decoded *d, struct pdp10_memory *memory, word_t word,
+	int cpu_model)
+{
+  const struct pdp10_instruction *op;
+  const struct its_oper *oper;
+  int address;
+
+  memset (d, 0, sizeof *d);
+  d->a_hint = -1;
+  d->y_hint = -1;
+  d->setz = -1;
 
   op = lookup (word, cpu_model);
   if (op == NULL)
     {
+      d->kind = DECODED_DATA;
+      /* If no opcode found and left half is 0, show as symbol. */
       if ((word >> 18) == 0 && Y (word) != 0)
-	{
-	  /* If no opcode found and left half is 0, print as symbol. */
-	  sym = get_symbol_by_value (Y (word), HINT_ADDRESS);
-	  if (sym != NULL)
-	    n += printf ("%s", sym->name);
-	}
+	d->y_hint = HINT_ADDRESS;
     }
   else if (OPCODE (word) == ITS_OPER)
     {
-      const struct its_oper *oper;
+      d->kind = DECODED_OPER;
       oper = lookup_oper (word);
       if (oper)
 	{
-	  n += printf ("%-8s ", oper->name);
+	  d->name = oper->name;
+	  d->mnemonic = pdp10_num_instructions + (oper - opers) + 1;
 	  if (oper->hint == HINT_CHANNEL || A (word) != 0)
-	    n += print_val ("%o,", A (word), oper->hint);
+	    d->a_hint = oper->hint;
 	}
     }
-#if 1
   else if (OPCODE_A (word) == ITS_CALL)
     {
-      int address;
-      
-      n += printf ("%-8s ", ".call");
-
+      d->kind = DECODED_CALL;
+      d->name = op->name;
+      d->mnemonic = op - pdp10_instruction + 1;
       address = calc_e (memory, word);
-      if (address == -1 ||
-	  get_word_at (memory, address) != SETZ)
-	{
-	  if (I (word))
-	    n += printf ("@");
-	  n += print_val ("%o", Y (word), HINT_ADDRESS);
-	  if (X (word))
-	    n += print_val ("(%o)", X (word), HINT_ACCUMULATOR);
-	}
+      if (address != -1 && get_word_at (memory, address) == SETZ)
+	d->setz = address;
       else
 	{
-	  char name[7];
-	  int i;
-	  word_t w;
-
-	  n = 0;
-	  printf ("[setz\n");
-	  w = get_word_at (memory, address + 1);
-	  sixbit_to_ascii (w, name);
-	  printf ("                                 SIXBIT/%s/\n", name);
-	  i = 2;
-	  while (((w = get_word_at (memory, address + i)) & SIGNBIT) == 0)
-	    {
-	      printf ("                                 %012llo\n", w);
-	      i++;
-	    }
-	  printf ("                                 %012llo]\n", w);
-	  printf ("                       ");
+	  d->e = 1;
+	  d->y_hint = HINT_ADDRESS;
 	}
     }
-#endif
   else
     {
-      n += printf ("%-8s ", op->name);
+      d->kind = DECODED_INSTRUCTION;
+      d->name = op->name;
+      d->mnemonic = op - pdp10_instruction + 1;
 
       if (op->type & PDP10_IO)
 	{
-	  const struct pdp10_device *dev;
-	  dev = lookup_device (DEVICE (word), cpu_model);
-	  if (dev != NULL)
-	    n += printf ("%s, ", dev->name);
-	  else
-	    n += print_val ("%o, ", DEVICE (word), HINT_DEVICE);
+	  d->io = 1;
+	  d->device = lookup_device (DEVICE (word), cpu_model);
 	}
       else if (!(op->type & PDP10_A_OPCODE))
 	{
 	  if (A (word) != 0 || !(op->type & PDP10_A_UNUSED))
-	    {
-	      hint = op->ac_hint ? op->ac_hint : HINT_ACCUMULATOR;
-	      n += print_val ("%o, ", A (word), hint);
-	    }
+	    d->a_hint = op->ac_hint ? op->ac_hint : HINT_ACCUMULATOR;
 	}
 
       if (E (word) != 0 || !(op->type & PDP10_E_UNUSED))
 	{
-	  if (I (word))
-	    n += printf ("@");
-
+	  d->e = 1;
 	  if (op->addr_hint == HINT_FLOAT && X (word) == 0)
 	    {
-	      const struct symbol *sym = get_symbol_by_value (Y (word), hint);
-	      if (sym == NULL)
-		n += printf ("(%f)", immediate_float (Y (word)));
-	      else
-		n += printf ("%s", sym->name);
+	      /* The symbol is looked up like the A field's. */
+	      d->immediate_float = 1;
+	      d->y_hint = d->a_hint != -1 ? d->a_hint : HINT_ACCUMULATOR;
 	    }
 	  else if (Y (word) != 0 && X (word) != 0)
-	    n += print_val ("%o", Y (word), HINT_OFFSET);
+	    d->y_hint = HINT_OFFSET;
 	  else if (op->addr_hint != 0 && X (word) == 0)
-	    n += print_val ("%o", Y (word), op->addr_hint);
+	    d->y_hint = op->addr_hint;
 	  else if (Y (word) != 0 ||
 		   (I (word) != 0 && X (word) == 0) ||
 		   (!(op->type & PDP10_E_UNUSED) && X (word) == 0))
-	    n += print_val ("%o", Y (word), HINT_ADDRESS);
+	    d->y_hint = HINT_ADDRESS;
+	}
+    }
+
+  if (d->device != NULL)
+    d->device_mnemonic = pdp10_num_instructions + NUM_OPERS
+			 + (d->device - pdp10_device) + 1;
+}
+
+/* Render everything on a line after the address.  Return nonzero if
+   it only depends on the word, the CPU model, and the symbols. */
+static int
+format_instruction (struct line *line, struct pdp10_memory *memory,
+		    word_t word, int cpu_model)
+{
+  const struct symbol *sym;
+  struct decoded d;
+  char ch[5];
+  int i, n;
+
+  put_octal (line, word, 12);
+  put_string (line, "  ");
+
+  n = 0;
+
+  decode (&d, memory, word, cpu_model);
+  if (d.kind == DECODED_DATA)
+    {
+      if (d.y_hint != -1)
+	{
+	  sym = get_symbol_by_value (Y (word), d.y_hint);
+	  if (sym != NULL)
+	    n += put_string (line, sym->name);
+	}
+    }
+  else if (d.kind == DECODED_OPER)
+    {
+      if (d.name != NULL)
+	n += put_name (line, d.name);
+      if (d.a_hint != -1)
+	n += print_val (line, "%o,", A (word), d.a_hint);
+    }
+  else if (d.setz != -1)
+    {
+      char name[7];
+      word_t w;
+
+      put_name (line, d.name);
+      put_string (line, "[setz\n");
+      w = get_word_at (memory, d.setz + 1);
+      sixbit_to_ascii (w, name);
+      put_string (line, "                                 SIXBIT/");
+      put_string (line, name);
+      put_string (line, "/\n");
+      i = 2;
+      while (((w = get_word_at (memory, d.setz + i)) & SIGNBIT) == 0)
+	{
+	  put_string (line, "                                 ");
+	  put_octal (line, w, 12);
+	  put_char (line, '\n');
+	  i++;
+	}
+      put_string (line, "                                 ");
+      put_octal (line, w, 12);
+      put_string (line, "]\n");
+      put_string (line, "                       ");
+    }
+  else
+    {
+      n += put_name (line, d.name);
+
+      if (d.io && d.device != NULL)
+	{
+	  n += put_string (line, d.device->name);
+	  n += put_string (line, ", ");
+	}
+      else if (d.io)
+	n += print_val (line, "%o, ", DEVICE (word), HINT_DEVICE);
+      else if (d.a_hint != -1)
+	n += print_val (line, "%o, ", A (word), d.a_hint);
+
+      if (d.e)
+	{
+	  if (I (word))
+	    n += put_char (line, '@');
+
+	  if (d.immediate_float)
+	    {
+	      sym = get_symbol_by_value (Y (word), d.y_hint);
+	      if (sym == NULL)
+		{
+		  char tmp[64];
+		  snprintf (tmp, sizeof tmp, "(%f)",
+			    immediate_float (Y (word)));
+		  n += put_string (line, tmp);
+		}
+	      else
+		n += put_string (line, sym->name);
+	    }
+	  else if (d.y_hint != -1)
+	    n += print_val (line, "%o", Y (word), d.y_hint);
 
 	  if (X (word))
-	    n += print_val ("(%o)", X (word), HINT_ACCUMULATOR);
+	    n += print_val (line, "(%o)", X (word), HINT_ACCUMULATOR);
 	}
     }
 
-  spaces (25 - n);
+  spaces (line, 25 - n);
 
 #if 0
   /* Print instruction execution time. */
   {
     int t = instruction_time (word, PDP10_KI10);
     if (t > 0)
-      printf (";%5dns", t);
+      {
+	char tmp[16];
+	snprintf (tmp, sizeof tmp, ";%5dns", t);
+	put_string (line, tmp);
+      }
     else
-      spaces (8);
+      spaces (line, 8);
   }
 #endif
 
 #if 1
   /* Print word as six SIXBIT characters. */
-  printf (";\"");
+  put_string (line, ";\"");
   for (i = 0; i < 6; i++)
     {
       int c = (int)(word >> (6 * (5 - i))) & 077;
-      putchar (c + ' ');
+      put_char (line, c + ' ');
     }
-  putchar ('"');
+  put_char (line, '"');
 #endif
 
 #if 1
   /* Print word as five ASCII characters, if it seems likely to be a
    * printable string. */
-  printable = 1;
-  for (i = 0; i < 5; i++)
-    {
-      ch[i] = (word >> (((4 - i) * 7) + 1)) & 0177;
-      switch (ch[i])
-	{
-	case '\0':
-	case '\t':
-	case '\n':
-	case '\f':
-	case '\r':
-	case '\033':
-	  break;
-	default:
-	  if (ch[i] < 040 || ch[i] > 0176)
-	    printable = 0;
-	  break;
-	}
-    }
-
-  if ((word & 1) == 1 ||
-      word == 0 ||
-      word == POPJ_17)
-    printable = 0;
-
-  {
-    int seen_nonzero = 0;
-    for (i = 4; i >= 0; i--)
-      {
-	if (ch[i] == 0)
-	  {
-	    if (seen_nonzero)
-	      printable = 0;
-	  }
-	else
-	  seen_nonzero = 1;
-      }
-  }
-
-  if (printable)
+  if (ascii_printable (word, ch))
     {
-      printf (" \"");
+      put_string (line, " \"");
       for (i = 0; i < 5; i++)
 	{
 	  switch (ch[i])
 	    {
 	    case '\0':
-	      printf ("\\0");
+	      put_string (line, "\\0");
 	      break;
 	    case '\t':
-	      printf ("\\t");
+	      put_string (line, "\\t");
 	      break;
 	    case '\n':
-	      printf ("\\n");
+	      put_string (line, "\\n");
 	      break;
 	    case '\f':
-	      printf ("\\f");
+	      put_string (line, "\\f");
 	      break;
 	    case '\r':
-	      printf ("\\r");
+	      put_string (line, "\\r");
 	      break;
 	    case '\\':
-	      printf ("\\\\");
+	      put_string (line, "\\\\");
 	      break;
 	    case '\"':
-	      printf ("\\\"");
+	      put_string (line, "\\\"");
 	      break;
 	    default:
 	      if (ch[i] < 040 || ch[i] > 0176)
-		printf ("\\%03o", ch[i]);
+		{
+		  put_char (line, '\\');
+		  put_octal (line, ch[i], 3);
+		}
 	      else
-		putchar (ch[i]);
+		put_char (line, ch[i]);
 	      break;
 	    }
 	}
-      printf ("\"");
+      put_char (line, '"');
     }
 #endif
 
 #if 0
   /* Print word as six SQUOZE characters. */
   squoze_to_ascii (word, ch);
-  printf (" \"%s\"", ch);
+  put_string (line, " \"");
+  put_string (line, ch);
+  put_char (line, '"');
 #endif
 
-  printf ("\n");
+  put_char (line, '\n');
+  /* Whether E is a SETZ block depends on memory. */
+  return d.kind != DECODED_CALL;
+}
+
+/* The rest of a line is remembered for recently seen words, since
+   images have many copies of some words, like zeros or POPJ 17,.
+   Each thread has its own cache, so parallel disassembly needs no
+   locking. */
+#define RENDERED_SIZE	1024
+#define RENDERED_TEXT	96
+
+struct rendered {
+  word_t word;
+  int cpu_model;
+  int generation;
+  int length;			/* Zero if unused. */
+  char text[RENDERED_TEXT];
+};
+
+static __thread struct rendered rendered[RENDERED_SIZE];
+
+/* Render the disassembly of a word into buffer, which holds size
+   characters.  Like snprintf, the return value is the full length of
+   the text, which may be more than was stored. */
+int
+format_word (char *buffer, int size, struct pdp10_memory *memory,
+	     word_t word, int address, int cpu_model)
+{
+  struct line line_buffer, *line = &line_buffer;
+  const struct symbol *sym;
+  struct rendered *r;
+  int start, generation;
+
+  line->buffer = buffer;
+  line->size = size;
+  line->length = 0;
+
+  sym = get_symbol_by_value (address, HINT_ADDRESS);
+  if (sym != NULL)
+    {
+      put_string (line, sym->name);
+      put_string (line, ":\n");
+    }
+
+  if (address == -1)
+    put_string (line, "         ");
+  else
+    {
+      put_octal (line, address, 6);
+      put_string (line, ":  ");
+    }
+
+  start = line->length;
+  generation = symbols_generation ();
+  r = &rendered[((unsigned long long)word * 0x9E3779B97F4A7C15ULL) >> 54];
+  if (r->length > 0 && r->word == word && r->cpu_model == cpu_model
+      && r->generation == generation)
+    put_string (line, r->text);
+  else if (format_instruction (line, memory, word, cpu_model)
+	   && line->length - start < RENDERED_TEXT
+	   && line->length <= line->size)
+    {
+      r->word = word;
+      r->cpu_model = cpu_model;
+      r->generation = generation;
+      r->length = line->length - start;
+      memcpy (r->text, line->buffer + start, r->length);
+      r->text[r->length] = 0;
+    }
+
+  if (line->length < line->size)
+    line->buffer[line->length] = 0;
+  else if (line->size > 0)
+    line->buffer[line->size - 1] = 0;
+
+  return line->length;
+}
+
+void
+fdisassemble_word (FILE *f, struct pdp10_memory *memory, word_t word,
+		   int address, int cpu_model)
+{
+  char buffer[200], *text = buffer;
+  int n;
+
+  n = format_word (buffer, sizeof buffer, memory, word, address, cpu_model);
+  if (n >= (int)sizeof buffer)
+    {
+      /* Long symbol names or a .call block. */
+      text = malloc (n + 1);
+      if (text == NULL)
+	{
+	  fprintf (stderr, "Out of memory\n");
+	  exit (1);
+	}
+      format_word (text, n + 1, memory, word, address, cpu_model);
+    }
+
+  fwrite (text, 1, n, f);
+
+  if (text != buffer)
+    free (text);
+}
+
+void
+disassemble_word (struct pdp10_memory *memory, word_t word,
+		  int address, int cpu_model)
+{
+  fdisassemble_word (output_file, memory, word, address, cpu_model);
+}
+
+/* Machine readable listings.  Each word is decoded into a record,
+   which is written as is, or as a line of JSON. */
+
+void
+usage_listing_format (void)
+{
+  fprintf (stderr, "Valid listing formats are: text, jsonl, binary.\n");
+}
+
+int
+parse_listing_format (const char *string)
+{
+  if (strcmp (string, "text") == 0)
+    dis10->listing_format = LISTING_TEXT;
+  else if (strcmp (string, "jsonl") == 0)
+    dis10->listing_format = LISTING_JSONL;
+  else if (strcmp (string, "binary") == 0)
+    dis10->listing_format = LISTING_BINARY;
+  else
+    return -1;
+  return 0;
+}
+
+static int
+symbol_id (const struct symbol *sym)
+{
+  return sym == NULL ? 0 : sym->sequence;
+}
+
+/* Decode a word into a record, with the mnemonics and symbols the
+   text listing shows. */
+void
+decode_word (struct dis10_record *record, struct pdp10_memory *memory,
+	     word_t word, int address, int cpu_model)
+{
+  struct decoded d;
+  char ch[5];
+
+  memset (record, 0, sizeof *record);
+  if (word & START_FILE)
+    record->flags |= RECORD_START_FILE;
+  else if (word & START_RECORD)
+    record->flags |= RECORD_START_RECORD;
+  word &= WORDMASK;
+
+  record->word = word;
+  record->address = address;
+  record->a = A (word);
+  record->i = I (word) != 0;
+  record->x = X (word);
+  record->y = Y (word);
+  if (address != -1)
+    record->label = symbol_id (get_symbol_by_value (address, HINT_ADDRESS));
+
+  decode (&d, memory, word, cpu_model);
+  record->opcode = d.mnemonic;
+  record->device = d.device_mnemonic;
+  record->setz = d.setz;
+  if (d.io && d.device == NULL)
+    record->a_symbol
+      = symbol_id (get_symbol_by_value (DEVICE (word), HINT_DEVICE));
+  else if (d.a_hint != -1)
+    record->a_symbol = symbol_id (get_symbol_by_value (A (word), d.a_hint));
+  if (d.y_hint != -1)
+    record->y_symbol = symbol_id (get_symbol_by_value (Y (word), d.y_hint));
+  if (d.immediate_float)
+    record->flags |= RECORD_FLOAT;
+
+  if (ascii_printable (word, ch))
+    record->flags |= RECORD_ASCII;
+  if (sixbit_plausible (word))
+    record->flags |= RECORD_SIXBIT;
+}
+
+static void
+json_string (FILE *f, const char *string)
+{
+  fputc ('"', f);
+  for (; *string != 0; string++)
+    {
+      if (*string == '"' || *string == '\\')
+	fprintf (f, "\\%c", *string);
+      else if ((unsigned char)*string < 040)
+	fprintf (f, "\\u%04x", *string);
+      else
+	fputc (*string, f);
+    }
+  fputc ('"', f);
+}
+
+static void
+json_symbol (FILE *f, const char *key, int id)
+{
+  const struct symbol *symbols;
+
+  if (id == 0)
+    return;
+  get_symbols (&symbols);
+  fprintf (f, ",\"%s\":", key);
+  json_string (f, symbols[id - 1].name);
+}
+
+static void
+json_mnemonic (FILE *f, const char *key, int id)
+{
+  if (id == 0)
+    return;
+  fprintf (f, ",\"%s\":", key);
+  json_string (f, mnemonic_name (id - 1));
+}
+
+static void
+list_record (FILE *f, struct pdp10_memory *memory, word_t word,
+	     int address, int cpu_model)
+{
+  struct dis10_record record;
+
+  decode_word (&record, memory, word, address, cpu_model);
+  if (dis10->listing_format == LISTING_BINARY)
+    {
+      fwrite (&record, sizeof record, 1, f);
+      return;
+    }
+
+  fprintf (f, "{\"address\":%d,\"word\":\"%012llo\",\"opcode\":",
+	   record.address, record.word);
+  if (record.opcode == 0)
+    fputs ("null", f);
+  else
+    json_string (f, mnemonic_name (record.opcode - 1));
+  json_mnemonic (f, "device", record.device);
+  fprintf (f, ",\"a\":%d,\"i\":%d,\"x\":%d,\"y\":%d",
+	   record.a, record.i, record.x, record.y);
+  if (record.setz != -1)
+    fprintf (f, ",\"setz\":%d", record.setz);
+  if (record.flags & RECORD_FLOAT)
+    fputs (",\"float\":true", f);
+  json_symbol (f, "label", record.label);
+  json_symbol (f, "a_symbol", record.a_symbol);
+  json_symbol (f, "y_symbol", record.y_symbol);
+  fprintf (f, ",\"ascii\":%s,\"sixbit\":%s",
+	   record.flags & RECORD_ASCII ? "true" : "false",
+	   record.flags & RECORD_SIXBIT ? "true" : "false");
+  if (record.flags & RECORD_START_FILE)
+    fputs (",\"start\":\"file\"", f);
+  else if (record.flags & RECORD_START_RECORD)
+    fputs (",\"start\":\"record\"", f);
+  fputs ("}\n", f);
+}
+
+/* Start the listing, after the file is loaded.  A binary listing
+   starts with "D10R", the version, the size of a record, the number
+   of mnemonics and of symbols, and their names.  The records which
+   follow start on a multiple of eight bytes. */
+void
+begin_listing (FILE *f)
+{
+  static const char zero[8];
+  const struct symbol *symbols;
+  const char *name;
+  int header[4];
+  size_t size;
+  int i;
+
+  switch (dis10->listing_format)
+    {
+    case LISTING_TEXT:
+      fprintf (f, "\nDisassembly:\n\n");
+      break;
+    case LISTING_JSONL:
+      break;
+    case LISTING_BINARY:
+      header[0] = 2;
+      header[1] = sizeof (struct dis10_record);
+      header[2] = num_mnemonics ();
+      header[3] = get_symbols (&symbols);
+      fwrite ("D10R", 1, 4, f);
+      fwrite (header, sizeof header, 1, f);
+      size = 4 + sizeof header;
+      for (i = 0; i < header[2] + header[3]; i++)
+	{
+	  if (i < header[2])
+	    name = mnemonic_name (i);
+	  else
+	    name = symbols[i - header[2]].name;
+	  fwrite (name, 1, strlen (name) + 1, f);
+	  size += strlen (name) + 1;
+	}
+      fwrite (zero, 1, -size & 7, f);
+      break;
+    }
 }
 
 void
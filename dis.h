@@ -18,6 +18,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <setjmp.h>
 
 #define WORDMASK	(0777777777777LL)
 #define SIGNBIT		(0400000000000LL)
@@ -35,10 +36,14 @@ typedef long long word_t;
 struct FILE;
 struct pdp10_file;
 struct pdp10_memory;
+struct pdp10_instruction;
+struct symbol_table;
 
 struct file_format {
   const char *name;
   void (*read) (FILE *f, struct pdp10_memory *memory, int cpu);
+  /* Read and disassemble at the same time, or NULL. */
+  void (*stream) (FILE *f, struct pdp10_memory *memory, int cpu);
 };
 
 struct word_format {
@@ -47,13 +52,112 @@ struct word_format {
   void (*rewind_word) (FILE *);		/* NULL means just rewind (f) */
   void (*write_word) (FILE *, word_t);
   void (*flush_word) (FILE *);		/* NULL means do nothing */
+  int (*get_words) (FILE *, word_t *, int); /* NULL means use get_word */
+  void (*write_words) (FILE *, const word_t *, int); /* NULL: write_word */
 };
 
+/* Scrambling parameters computed from a password. */
+struct scramble_key {
+  word_t password;
+  word_t seed;				/* Initial random seed. */
+  word_t steps[4];			/* Order << 18 | operation. */
+  int shift;				/* Rotation. */
+  int decrypt;
+};
+
+/* State kept between calls for one stream of words, by the word
+   formats which need it. */
+struct word_stream {
+  int leftover;				/* its, bin */
+  int have_leftover;
+  int previous_octet;			/* its output */
+  word_t *buffer;			/* tape record */
+  int n, words;
+  int end_of_file, end_of_tape;
+};
+
+#define WORD_STREAM_INIT { .previous_octet = -1, .end_of_file = 1 }
+
+/* Everything the library keeps between calls, other than the memory
+   being disassembled.  Each thread has a current context.  A thread
+   starts out with the default context, and can switch to another with
+   dis10_use.  Contexts can be used by one thread at a time, except
+   that parallel disassembly shares one between its workers. */
+struct dis10_context {
+  struct file_format *file_format;	/* input */
+  struct word_format *word_format;	/* input */
+  struct word_format *output_format;
+  struct word_stream input;
+  struct word_stream output;
+  word_t checksum;
+  int symbols_mode;
+  struct symbol_table *symbols;
+  const struct pdp10_instruction **decode_table;
+  int decode_model;
+  FILE *listing;			/* NULL for stdout */
+  jmp_buf *failure;
+  int collapse;				/* show runs of a word once */
+  int listing_format;			/* LISTING_TEXT etc. */
+};
+
+/* The defaults each thread starts out with.  The symbol and opcode
+   tables are made when they are first needed. */
+#define DIS10_CONTEXT_INIT {			\
+  .word_format = &its_word_format,		\
+  .output_format = &its_word_format,		\
+  .input = WORD_STREAM_INIT,			\
+  .output = WORD_STREAM_INIT,			\
+  .symbols_mode = SYMBOLS_NONE,			\
+  .decode_model = -1,				\
+  .listing_format = LISTING_TEXT		\
+}
+
+extern __thread struct dis10_context *dis10;
+
+extern struct dis10_context *dis10_new (void);
+extern void	dis10_free (struct dis10_context *context);
+extern struct dis10_context *dis10_use (struct dis10_context *context);
+extern void	dis10_fail (void) __attribute__ ((noreturn));
+
+/* These used to be global variables, and are kept as names for the
+   current context's fields. */
+#define input_file_format	(dis10->file_format)
+#define input_word_format	(dis10->word_format)
+#define output_word_format	(dis10->output_format)
+#define output_file \
+  (dis10->listing != NULL ? dis10->listing : stdout)
+
 enum { SYMBOLS_NONE, SYMBOLS_DDT, SYMBOLS_ALL };
 
+enum { BULK_SCALAR, BULK_SSSE3, BULK_AVX2, BULK_AVX512 };
+
 enum { START_FILE = 1LL << 36, START_RECORD = 1LL << 37 };
 
-extern struct file_format *input_file_format;
+enum { LISTING_TEXT, LISTING_JSONL, LISTING_BINARY };
+
+/* A word in a binary listing.  Mnemonics and symbols are numbered
+   from one, in the order of their names in the header of the listing.
+   Zero means none. */
+struct dis10_record {
+  long long word;
+  int address;				/* -1 if none */
+  int opcode;				/* Mnemonic. */
+  int device;				/* Mnemonic of an I/O device. */
+  int y;
+  int label;				/* Symbol for the address. */
+  int a_symbol;				/* Symbol for A, or the device. */
+  int y_symbol;
+  int setz;				/* .call block, or -1 */
+  unsigned char a, i, x, flags;
+  int reserved;
+};
+
+#define RECORD_ASCII		1	/* Looks like ASCII text. */
+#define RECORD_SIXBIT		2	/* Looks like SIXBIT text. */
+#define RECORD_START_FILE	4
+#define RECORD_START_RECORD	8
+#define RECORD_FLOAT		16	/* Y is a float, if not a symbol. */
+
 extern struct file_format dmp_file_format;
 extern struct file_format mdl_file_format;
 extern struct file_format pdump_file_format;
@@ -61,8 +165,6 @@ extern struct file_format raw_file_format;
 extern struct file_format sblk_file_format;
 extern struct file_format shr_file_format;
 
-extern struct word_format *input_word_format;
-extern struct word_format *output_word_format;
 extern struct word_format aa_word_format;
 extern struct word_format bin_word_format;
 extern struct word_format cadr_word_format;
@@ -83,11 +185,16 @@ extern void     usage_word_format (void);
 extern int      parse_input_word_format (const char *);
 extern int      parse_output_word_format (const char *);
 extern word_t	get_word (FILE *f);
+extern int	get_words (FILE *f, word_t *buffer, int n);
+extern int	get_fixed_words (FILE *f, word_t *buffer, int n, int octets,
+				 void (*unpack) (const unsigned char *,
+						 word_t *, int));
 extern word_t	get_checksummed_word (FILE *f);
 extern void	reset_checksum (word_t);
 extern void	check_checksum (word_t);
 extern void	rewind_word (FILE *f);
 extern void	write_word (FILE *, word_t);
+extern void	write_words (FILE *, const word_t *buffer, int n);
 extern void	flush_word (FILE *);
 extern int      get_7track_record (FILE *f, word_t **buffer);
 extern int      get_9track_record (FILE *f, word_t **buffer);
@@ -95,6 +202,19 @@ extern void     write_7track_record (FILE *f, word_t *buffer, int);
 extern void     write_9track_record (FILE *f, word_t *buffer, int);
 extern word_t	get_core_word (FILE *f);
 extern void	write_core_word (FILE *f, word_t word);
+extern int	bulk_select (int level);
+extern void	unpack_core_words (const unsigned char *data, word_t *words,
+				   int n);
+extern void	pack_core_words (const word_t *words, unsigned char *data,
+				 int n);
+extern void	unpack_dta_words (const unsigned char *data, word_t *words,
+				  int n);
+extern void	pack_dta_words (const word_t *words, unsigned char *data,
+				int n);
+extern void	unpack_bin_words (const unsigned char *data, word_t *words,
+				  int pairs);
+extern void	pack_bin_words (const word_t *words, unsigned char *data,
+				int pairs);
 extern void	read_raw_at (FILE *f, struct pdp10_memory *memory,
 			     int address);
 extern void	sblk_info (FILE *f, word_t word0, int cpu_model);
@@ -108,8 +228,26 @@ extern int      parse_symbols_mode (const char *string);
 extern void     usage_machine (void);
 extern int      parse_machine (const char *string, int *machine);
 extern void	dis (struct pdp10_memory *memory, int cpu_model);
+extern void	dis_range (struct pdp10_memory *memory, int start, int end,
+			   int cpu_model);
+extern void	dis_parallel (struct pdp10_memory *memory, int cpu_model,
+			      int jobs);
+extern void	dis_stream (FILE *f, struct pdp10_memory *memory,
+			    int address, int cpu_model);
 extern void	disassemble_word (struct pdp10_memory *memory, word_t word,
 				  int address, int cpu_model);
+extern void	fdisassemble_word (FILE *f, struct pdp10_memory *memory,
+				   word_t word, int address, int cpu_model);
+extern int	calc_e (struct pdp10_memory *memory, word_t word);
+extern void	usage_listing_format (void);
+extern int	parse_listing_format (const char *string);
+extern void	begin_listing (FILE *f);
+extern void	decode_word (struct dis10_record *record,
+			     struct pdp10_memory *memory, word_t word,
+			     int address, int cpu_model);
+extern int	format_word (char *buffer, int size,
+			     struct pdp10_memory *memory, word_t word,
+			     int address, int cpu_model);
 extern word_t   ascii_to_sixbit (char *ascii);
 extern void	sixbit_to_ascii (word_t sixbit, char *ascii);
 extern void	squoze_to_ascii (word_t squoze, char *ascii);
@@ -119,6 +257,13 @@ extern void	print_datime (FILE *, word_t t);
 extern int	byte_size (int, int *);
 extern void	scramble (int decrypt, int verbose, word_t password,
 		          const word_t *input, word_t *output, int count);
+extern void	scramble_schedule (struct scramble_key *key, int decrypt,
+				   word_t password);
+extern word_t	scramble_word (const struct scramble_key *key, word_t *seed,
+			       word_t word);
+extern int	scramble_select (int level);
+extern void	scramble_keys (int decrypt, word_t password, int n,
+			       int index, word_t word, word_t *output);
 
 extern void weenixname (char *);
 extern void weenixpath (char *, word_t, word_t, word_t);
@@ -22,14 +22,76 @@
 static void
 read_dmp (FILE *f, struct pdp10_memory *memory, int cpu_model)
 {
-  printf ("DMP format\n");
+  fprintf (output_file, "DMP format\n");
 
   read_raw_at (f, memory, 074);
 
   dmp_info (memory, cpu_model);
 }
 
+/* Streaming takes two passes over the file.  The first only keeps the
+   pages with the words dmp_info looks at, and the second disassembles.
+   A file which can't be read twice is loaded as usual. */
+static void
+stream_dmp (FILE *f, struct pdp10_memory *memory, int cpu_model)
+{
+  int address = 074, start = 0, end = 0, n;
+  word_t *data, jbsym;
+
+  if (fseek (f, 0, SEEK_CUR) != 0)
+    {
+      read_dmp (f, memory, cpu_model);
+      fprintf (output_file, "\nDisassembly:\n\n");
+      dis (memory, cpu_model);
+      return;
+    }
+
+  fprintf (output_file, "DMP format\n");
+
+  for (;;)
+    {
+      data = alloc_words (memory, ITS_PAGESIZE);
+      if (data == NULL)
+	{
+	  fprintf (stderr, "out of memory\n");
+	  exit (1);
+	}
+
+      n = get_words (f, data, ITS_PAGESIZE);
+      if (address == 074 || (address < end && address + n > start))
+	{
+	  trim_words (memory, data, n);
+	  if (n > 0)
+	    add_memory (memory, address, n, data);
+	}
+      else
+	trim_words (memory, data, 0);
+      if (n == 0)
+	break;
+
+      /* The symbol table, from .JBSYM in the first page. */
+      if (address == 074)
+	{
+	  jbsym = get_word_at (memory, 0116);
+	  if (jbsym != -1)
+	    {
+	      start = jbsym & 0777777;
+	      end = start - ((jbsym >> 18) | ((-1) & ~0777777));
+	    }
+	}
+      address += n;
+    }
+
+  dmp_info (memory, cpu_model);
+  clear_memory (memory);
+
+  fprintf (output_file, "\nDisassembly:\n\n");
+  rewind_word (f);
+  dis_stream (f, memory, 074, cpu_model);
+}
+
 struct file_format dmp_file_format = {
   "dmp",
-  read_dmp
+  read_dmp,
+  stream_dmp
 };
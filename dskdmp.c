@@ -13,11 +13,16 @@
     You should have received a copy of the GNU General Public License
     along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include "dis.h"
+#include "stats.h"
 
-#define RP06_IMAGE_SIZE 316047360
 #define SECTOR_WORDS 128
 #define BLOCK_WORDS 1024
 #define BLOCK_SECTORS (BLOCK_WORDS / SECTOR_WORDS)
@@ -31,7 +36,12 @@
 #define UNIGFL 0000024000000LL
 #define UNDUMP 0400000000000LL
 
-word_t image[RP06_IMAGE_SIZE / 8 + 1];
+/* Blocks are read from the image when first used, and kept. */
+static int image;
+static word_t **cache;
+static int cache_size;
+static word_t zero_block[BLOCK_WORDS];
+
 int blocks;
 int mblks;
 int xblks;
@@ -45,51 +55,58 @@ int tutblk;
 int mdnuds;
 char *type;
 
-static int
-get_byte (FILE *f)
-{
-  int c = fgetc (f);
-  return c == EOF ? -1 : c;
-}
-
-static word_t get_disk_word (FILE *f)
+static word_t get_disk_word (const unsigned char *data)
 {
-  int i, x;
+  int i;
   word_t w = 0;
 
   for (i = 0; i < 8; i++)
-    {
-      x = get_byte (f);
-      if (x == -1)
-	return -1;
-
-      w += (word_t)x << (i * 8);
-    }
+    w += (word_t)data[i] << (i * 8);
 
   return w;
 }
 
 static word_t *
-get_block (int block)
+read_block (int block)
 {
+  unsigned char data[8 * BLOCK_WORDS];
   int cylinder = block / nblksc;
   int sector = cylinder * nsecsc;
-  return &image[sector * SECTOR_WORDS
-		+ (block % nblksc) * BLOCK_WORDS];
-}
-
-static int read_block (FILE *f, word_t *buffer)
-{
+  off_t offset = 8 * ((off_t)sector * SECTOR_WORDS
+		      + (block % nblksc) * BLOCK_WORDS);
+  word_t *buffer;
+  ssize_t n;
   int i;
 
-  for (i = 0; i < BLOCK_WORDS; i++)
+  buffer = malloc (BLOCK_WORDS * sizeof *buffer);
+  if (buffer == NULL)
     {
-      buffer[i] = get_disk_word (f);
-      if (buffer[i] == -1)
-	return -1;
+      fprintf (stderr, "Out of memory.\n");
+      exit (1);
     }
 
-  return 0;
+  /* Past the end of the image, words are zero. */
+  n = pread (image, data, sizeof data, offset);
+  if (n < 0)
+    n = 0;
+  memset (data + n, 0, sizeof data - n);
+  STATS_ADD (STATS_BYTES, n);
+
+  for (i = 0; i < BLOCK_WORDS; i++)
+    buffer[i] = get_disk_word (data + 8 * i);
+  STATS_ADD (STATS_WORDS, BLOCK_WORDS);
+
+  return buffer;
+}
+
+static word_t *
+get_block (int block)
+{
+  if (block < 0 || block >= cache_size)
+    return zero_block;
+  if (cache[block] == NULL)
+    cache[block] = read_block (block);
+  return cache[block];
 }
 
 static void
@@ -332,27 +349,22 @@ show_mfd (void)
 int
 main (int argc, char **argv)
 {
-  word_t *buffer;
-  FILE *f;
+  struct stat st;
 
-  if (argc != 2)
+  if (parse_stats_option (&argc, argv) || argc != 2)
     {
-      fprintf (stderr, "Usage: %s <file>\n", argv[0]);
+      fprintf (stderr, "Usage: %s [--stats[=json]] <file>\n", argv[0]);
       exit (1);
     }
 
-  f = fopen (argv[1], "rb");
-
-  buffer = image;
-  blocks = 0;
-  for (;;)
+  image = open (argv[1], O_RDONLY);
+  if (image == -1 || fstat (image, &st) == -1)
     {
-      int n = read_block (f, buffer);
-      if (n == -1)
-	break;
-      buffer += BLOCK_WORDS;
-      blocks++;
+      fprintf (stderr, "%s: Error opening %s: %s\n",
+	       argv[0], argv[1], strerror (errno));
+      exit (1);
     }
+  blocks = st.st_size / (8 * BLOCK_WORDS);
 
   fprintf (stderr, "%o blocks in image\n", blocks);
 
@@ -385,6 +397,15 @@ main (int argc, char **argv)
   mfdblk = nblks/2-1;
   tutblk = mfdblk-ntutbl;
 
+  cache_size = blocks;
+  cache = calloc (cache_size, sizeof *cache);
+  if (cache == NULL)
+    {
+      fprintf (stderr, "Out of memory.\n");
+      exit (1);
+    }
+
+  stats_phase ("dump");
   show_disk ();
   show_tut();
   show_mfd();
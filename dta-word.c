@@ -27,10 +27,10 @@ get_byte (FILE *f)
 static inline word_t
 get_half (FILE *f)
 {
-  return (get_byte (f)
-	  + (get_byte (f) << 8)
-	  + (get_byte (f) << 16)
-	  + (get_byte (f) << 24));
+  return ((word_t)get_byte (f)
+	  + ((word_t)get_byte (f) << 8)
+	  + ((word_t)get_byte (f) << 16)
+	  + ((word_t)get_byte (f) << 24));
 }
 
 static word_t
@@ -52,6 +52,12 @@ get_dta_word (FILE *f)
   return word;
 }
 
+static int
+get_dta_words (FILE *f, word_t *buffer, int n)
+{
+  return get_fixed_words (f, buffer, n, 8, unpack_dta_words);
+}
+
 static void
 write_half (FILE *f, int word)
 {
@@ -68,10 +74,28 @@ write_dta_word (FILE *f, word_t word)
   write_half (f, word & 0777777);
 }
 
+static void
+write_dta_words (FILE *f, const word_t *buffer, int n)
+{
+  unsigned char data[8 * 1024];
+  int m;
+
+  while (n > 0)
+    {
+      m = n > 1024 ? 1024 : n;
+      pack_dta_words (buffer, data, m);
+      fwrite (data, 1, 8 * m, f);
+      buffer += m;
+      n -= m;
+    }
+}
+
 struct word_format dta_word_format = {
   "dta",
   get_dta_word,
   NULL,
   write_dta_word,
-  NULL
+  NULL,
+  get_dta_words,
+  write_dta_words
 };
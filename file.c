@@ -19,7 +19,6 @@
 
 #include "dis.h"
 
-struct file_format *input_file_format = NULL;
 
 static struct file_format *file_formats[] = {
   &dmp_file_format,
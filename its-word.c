@@ -17,8 +17,6 @@
 
 #include "dis.h"
 
-static int leftover, there_is_some_leftover = 0;
-
 static inline int
 get_byte (FILE *f)
 {
@@ -46,11 +44,11 @@ get_its_word (FILE *f)
   word = 0;
   bits = 0;
 
-  if (there_is_some_leftover)
+  if (dis10->input.have_leftover)
     {
-      word = leftover;
+      word = dis10->input.leftover;
       bits = 7;
-      there_is_some_leftover = 0;
+      dis10->input.have_leftover = 0;
     }
 
   while (bits < 36)
@@ -118,7 +116,7 @@ get_its_word (FILE *f)
 	  if (bits != 0)
 	    {
 	      fprintf (stderr, "[error in 36-bit file format]\n");
-	      exit (1);
+	      dis10_fail ();
 	    }
 	  word = byte & 017;
 	  word = (word << 8) | get_byte (f);
@@ -135,8 +133,8 @@ get_its_word (FILE *f)
 	}
       else if (bits == 42)
 	{
-	  leftover = word & 0177;
-	  there_is_some_leftover = 1;
+	  dis10->input.leftover = word & 0177;
+	  dis10->input.have_leftover = 1;
 	  word >>= 7;
 	  word <<= 1;
 	}
@@ -145,7 +143,7 @@ get_its_word (FILE *f)
   if (word > WORDMASK)
     {
       fprintf (stderr, "[error in 36-bit file format (word too large)]\n");
-      exit (1);
+      dis10_fail ();
     }
 
   return word;
@@ -154,7 +152,7 @@ get_its_word (FILE *f)
 static void
 rewind_its_word (FILE *f)
 {
-  there_is_some_leftover = 0;
+  dis10->input.have_leftover = 0;
   rewind (f);
 }
 
@@ -165,16 +163,14 @@ fputc2 (int c1, int c2, FILE *f)
   fputc (c2, f);
 }
 
-static int previous_octet = -1;
-
 static void
 flush_its_word (FILE *f)
 {
-  if (previous_octet == 015)
+  if (dis10->output.previous_octet == 015)
     fputc (0356, f);
-  else if (previous_octet == 0177)
+  else if (dis10->output.previous_octet == 0177)
     fputc (0357, f);
-  previous_octet = -1;
+  dis10->output.previous_octet = -1;
 }
 
 static void
@@ -205,7 +201,7 @@ ascii_word (FILE *f, word_t word)
     {
       c = octets[i];
 
-      if (previous_octet == 015)
+      if (dis10->output.previous_octet == 015)
 	{
 	  if (c == 012)
 	    fputc (012, f);
@@ -215,9 +211,9 @@ ascii_word (FILE *f, word_t word)
 	    fputc2 (0356, 0357, f);
 	  else
 	    fputc2 (0356, c, f);
-	  previous_octet = -1;
+	  dis10->output.previous_octet = -1;
 	}
-      else if (previous_octet == 0177)
+      else if (dis10->output.previous_octet == 0177)
 	{
 	  switch (c)
 	    {
@@ -238,10 +234,10 @@ ascii_word (FILE *f, word_t word)
 		fputc2 (0357, c, f);
 	      break;
 	    }
-	  previous_octet = -1;
+	  dis10->output.previous_octet = -1;
 	}
       else if (c == 015 || c == 0177)
-	previous_octet = c;
+	dis10->output.previous_octet = c;
       else if (c == 012)
 	fputc (015, f);
       else
@@ -263,5 +259,7 @@ struct word_format its_word_format = {
   get_its_word,
   rewind_its_word,
   write_its_word,
-  flush_its_word
+  flush_its_word,
+  NULL,
+  NULL
 };
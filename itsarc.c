@@ -13,11 +13,14 @@
     You should have received a copy of the GNU General Public License
     along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
 
+#include <errno.h>
 #include <time.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/time.h>
 
 #include "dis.h"
+#include "stats.h"
 
 #define VERY_OLD_ARC ((word_t)(0777777777777LL))
 #define OLD_ARC ((word_t)(0416243010101LL)) /* Sixbit ARC!!! */
@@ -28,12 +31,38 @@
 
 static int old = 0;
 
-/* Just allocate a full moby to hold the file. */
-static word_t buffer[256 * 1024];
+/* Only the directory is kept in memory.  File data is read straight
+   from the archive as it's needed. */
+static word_t dir[02000];
+static FILE *archive;
+static word_t position;		/* Index of the next word to be read. */
+
+/* The archive is in a word format without fixed-size words, so going
+   backwards means reading again from an earlier word.  Every
+   MARK_WORDS words, remember where in the file that word starts and
+   the word format state there. */
+#define MARK_WORDS 02000
+
+struct mark {
+  word_t position;
+  off_t offset;
+  struct word_stream input;
+};
+static struct mark *mark;
+static int marks, max_marks;
+
+/* For the directory listing, in order of file data. */
+struct entry {
+  int slot;
+  word_t data;
+  word_t length;
+  int seen;			/* Length read yet. */
+};
+static struct entry entry[02000 / 5 + 1];
 
 static void usage (const char *x)
 {
-  fprintf (stderr, "Usage: %s -x|-t <file>\n", x);
+  fprintf (stderr, "Usage: %s [--stats[=json]] -x|-t <file>\n", x);
   exit (1);
 }
 
@@ -66,25 +95,79 @@ timestamps (char *filename, word_t modified, word_t referenced)
 }
 
 static void
-extract_file (char *filename, word_t *data, word_t length)
+add_mark (void)
 {
-  FILE *f;
-  int i;
+  if (marks == max_marks)
+    {
+      max_marks = max_marks == 0 ? 64 : 2 * max_marks;
+      mark = realloc (mark, max_marks * sizeof *mark);
+      if (mark == NULL)
+	{
+	  fprintf (stderr, "Out of memory.\n");
+	  exit (1);
+	}
+    }
+  mark[marks].position = position;
+  mark[marks].offset = ftello (archive);
+  mark[marks].input = dis10->input;
+  marks++;
+}
 
-  f = fopen(filename, "wb");
-  for (i = 0; i < length; i++)
+/* Past the end, the archive reads as zeros. */
+static word_t
+read_word (void)
+{
+  word_t word;
+
+  if (position % MARK_WORDS == 0 && dis10->input.buffer == NULL
+      && (marks == 0 || mark[marks - 1].position < position))
+    add_mark ();
+
+  word = get_word (archive);
+  position++;
+  return word == -1 ? 0 : word;
+}
+
+/* Go back to the last mark at or before the word, and read up to it. */
+static void
+seek_word (word_t n)
+{
+  struct mark *m;
+
+  if (n < position)
     {
-      write_word (f, *data++);
+      for (m = &mark[marks - 1]; m->position > n; m--)
+	;
+      fseeko (archive, m->offset, SEEK_SET);
+      dis10->input = m->input;
+      position = m->position;
     }
+  while (position < n)
+    read_word ();
+}
 
-  flush_word (f);
-  fclose (f);
+static word_t
+arc_word (word_t n)
+{
+  if (n < 02000)
+    return dir[n];
+  seek_word (n);
+  return read_word ();
+}
+
+static void
+copy_words (FILE *f, word_t length)
+{
+  word_t i;
+
+  for (i = 0; i < length; i++)
+    write_word (f, read_word ());
 }
 
 static int
-ildb (word_t **w, int *p)
+ildb (int *w, int *p)
 {
-  word_t b = **w;
+  word_t b = arc_word (*w);
   b = b >> (30 - 6*(*p));
   b &= 077;
 
@@ -99,33 +182,30 @@ ildb (word_t **w, int *p)
 }
 
 static int
-extract_block (FILE *f, word_t *block, int *b, int *count)
+extract_block (FILE *f, int *b, int *count)
 {
-  word_t header = *block;
-  int i, n;
+  word_t header;
+  int n;
 
+  seek_word (*b);
+  header = read_word ();
   *b = header & 017777777;
   n = ((header >> 23) & 01777) + 1;
   *count += n;
 
   if (f)
-    {
-      block++;
-      for (i = 0; i < n; i++)
-	write_word (f, block[i]);
-    }
+    copy_words (f, n);
 
   return (header & 0200000000000LL) == 0;
 }
 
 static int
-extract_blocks (FILE *f, word_t *ufd, int undscp)
+extract_blocks (FILE *f, int undscp)
 {
-  word_t *d;
-  int o, b, n, n2, n3;
+  int d, o, b, n, n2, n3;
   int count = 0;
 
-  d = &ufd[11+undscp/6];
+  d = 11+undscp/6;
   o = undscp % 6;
 
   n = ildb (&d, &o);
@@ -139,8 +219,8 @@ extract_blocks (FILE *f, word_t *ufd, int undscp)
   n3 = ildb (&d, &o);
   b = ((n & 037) << 12) + (n2 << 6) + n3;
 
-  b = buffer[02005+b];
-  while (extract_block (f, &buffer[b], &b, &count))
+  b = arc_word (02005+b);
+  while (extract_block (f, &b, &count))
     ;
 
   return count;
@@ -149,15 +229,14 @@ extract_blocks (FILE *f, word_t *ufd, int undscp)
 static int
 extract_old_file (char *filename, int i, int extract)
 {
-  word_t *ufd = buffer;
-  int undscp = ufd[i+2] & 017777;
+  int undscp = dir[i+2] & 017777;
   FILE *f = NULL;
   int n;
 
   if (extract)
     f = fopen(filename, "wb");
 
-  n = extract_blocks (f, ufd, undscp);
+  n = extract_blocks (f, undscp);
 
   if (extract)
     {
@@ -168,18 +247,146 @@ extract_old_file (char *filename, int i, int extract)
   return n;
 }
 
+/* Print the start of a listing line, and make the file name for
+   extraction. */
+static void
+list_name (int i, char *filename)
+{
+  sixbit_to_ascii(dir[i], filename);
+  fprintf (stderr, "%s ", filename);
+  sixbit_to_ascii(dir[i+1], filename + 7);
+  fprintf (stderr, "%s  ", filename + 7);
+
+  weenixpath (filename, -1LL, dir[i], dir[i+1]);
+}
+
+static void
+list_rest (int i, word_t length)
+{
+  word_t modified = dir[i+3];
+  word_t referenced = (dir[i+4] & LEFT);
+  int leftovers;
+
+  fprintf (stderr, "%6lld  ", length);
+
+  print_datime (stderr, modified);
+  fputs ("  ", stderr);
+  print_date (stderr, referenced);
+
+  if (!old)
+    {
+      int author = (dir[i+4] >> 9) & 0777;
+      if (author != 0 && author != 0777)
+	fprintf (stderr, "  Author %03o", author);
+    }
+
+  fprintf (stderr, "  %d\n",
+	   byte_size (dir[i+4] & 0777, &leftovers));
+}
+
+static int
+by_data (const void *a, const void *b)
+{
+  const struct entry *x = a;
+  const struct entry *y = b;
+
+  if (x->data != y->data)
+    return x->data < y->data ? -1 : 1;
+  return x->slot - y->slot;
+}
+
+/* Old archives chain file blocks through the whole archive, so just
+   follow each chain. */
+static void
+list_old (word_t name_beg, int extract)
+{
+  char filename[14];
+  int i, length;
+
+  for (i = name_beg; i < 02000; i += 5)
+    {
+      list_name (i, filename);
+      length = extract_old_file (filename, i, extract);
+      timestamps (filename, dir[i+3], dir[i+4] & LEFT);
+      list_rest (i, length);
+    }
+}
+
+/* New archives have each file in one piece.  Visit them in the order
+   they appear in the archive, and print each listing line as soon as
+   it and all lines before it are known. */
+static void
+list_new (word_t name_beg, int extract)
+{
+  char filename[14];
+  struct entry *e;
+  int *order;
+  int i, n, next;
+  FILE *f;
+
+  n = 0;
+  for (i = name_beg; i < 02000; i += 5)
+    {
+      entry[n].slot = i;
+      entry[n].data = dir[i+2] & RIGHT;
+      entry[n].seen = 0;
+      n++;
+    }
+  qsort (entry, n, sizeof entry[0], by_data);
+
+  /* Where each slot ended up. */
+  order = malloc (n * sizeof *order);
+  if (order == NULL)
+    {
+      fprintf (stderr, "Out of memory.\n");
+      exit (1);
+    }
+  for (i = 0; i < n; i++)
+    order[(entry[i].slot - name_beg) / 5] = i;
+
+  next = 0;
+  for (i = 0; i < n; i++)
+    {
+      e = &entry[i];
+      seek_word (e->data);
+      e->length = read_word () - 3;
+      e->seen = 1;
+      read_word ();
+      read_word ();
+
+      if (extract)
+	{
+	  weenixpath (filename, -1LL, dir[e->slot], dir[e->slot+1]);
+	  f = fopen (filename, "wb");
+	  copy_words (f, e->length);
+	  flush_word (f);
+	  fclose (f);
+	  timestamps (filename, dir[e->slot+3], dir[e->slot+4] & LEFT);
+	}
+
+      while (next < n && entry[order[next]].seen)
+	{
+	  e = &entry[order[next++]];
+	  list_name (e->slot, filename);
+	  list_rest (e->slot, e->length);
+	}
+    }
+
+  free (order);
+}
+
 int
 main (int argc, char **argv)
 {
   int extract;
   char string[7];
-  word_t word;
-  word_t *p;
-  FILE *f;
+  int i;
 
   input_word_format = &its_word_format;
   output_word_format = &its_word_format;
 
+  if (parse_stats_option (&argc, argv))
+    usage (argv[0]);
   if (argc != 3)
     usage (argv[0]);
 
@@ -199,111 +406,71 @@ main (int argc, char **argv)
       break;
     }
 
-  f = fopen (argv[2], "rb");
-
-  p = buffer;
-  while ((word = get_word (f)) != -1)
+  archive = fopen (argv[2], "rb");
+  if (archive == NULL)
     {
-      *p++ = word;
+      fprintf (stderr, "%s: Error opening %s: %s\n",
+	       argv[0], argv[2], strerror (errno));
+      exit (1);
     }
-  fclose (f);
 
-  /* word_t arc_size = p - buffer; */
+  for (i = 0; i < 02000; i++)
+    dir[i] = read_word ();
 
-  if (buffer[0] == NEW_ARC)
+  if (dir[0] == NEW_ARC)
     {
       /* fprintf (stderr, "New ARC1!! archive.\n") */ ;
     }
-  else if (buffer[0] == OLD_ARC)
+  else if (dir[0] == OLD_ARC)
     {
       fprintf (stderr, "Old ARC!!! archive.\n");
       old = 1;
     }
-  else if (buffer[0] == VERY_OLD_ARC)
+  else if (dir[0] == VERY_OLD_ARC)
     {
       fprintf (stderr, "Old 777777777777 archive.\n");
       old = 1;
     }
   else
     {
-      sixbit_to_ascii(buffer[0], string);
-      fprintf (stderr, "First word: %012llo \"%s\"\n", buffer[0], string);
+      sixbit_to_ascii(dir[0], string);
+      fprintf (stderr, "First word: %012llo \"%s\"\n", dir[0], string);
       fprintf (stderr, "Not an ARC file.\n");
       exit (1);
     }
 
   word_t name_beg;
   if (old)
-     name_beg = buffer[2];
+     name_beg = dir[2];
   else
-     name_beg = buffer[1];
-  /* word_t data_end = buffer[2]; */
+     name_beg = dir[1];
+  /* word_t data_end = dir[2]; */
 
   fprintf (stderr, "Last cleanup: ");
-  print_datime (stderr, buffer[3]);
+  print_datime (stderr, dir[3]);
   fputc ('\n', stderr);
 
   if (!old)
     {
       fprintf (stderr, "Created: ");
-      print_datime (stderr, buffer[4]);
+      print_datime (stderr, dir[4]);
       fputc ('\n', stderr);
 
-      word_t dumped = buffer[5];
+      word_t dumped = dir[5];
       fprintf (stderr, "Dumped: %llo\n", dumped);
     }
 
   fprintf (stderr, "\nFile name       Words  Modified             Referenced  Byte\n");
 
-  int i;
-  for (i = name_beg; i < 02000; i += 5)
-    {
-      char filename[14];
-      word_t modified, referenced;
-
-      sixbit_to_ascii(buffer[i], filename);
-      fprintf (stderr, "%s ", filename);
-      sixbit_to_ascii(buffer[i+1], filename + 7);
-      fprintf (stderr, "%s  ", filename + 7);
-
-      /* File name for extraction. */
-      weenixpath (filename, -1LL, buffer[i], buffer[i+1]);
-
-      /* word_t flags = buffer[i+2] >> 18; */
-      word_t data = buffer[i+2] & RIGHT;
-
-      modified = buffer[i+3];
-      referenced = (buffer[i+4] & LEFT);
-
-      word_t length;
-      if (old) {
-	length = extract_old_file (filename, i, extract);
-	timestamps (filename, modified, referenced);
-      } else
-	length = buffer[data] - 3;
-      fprintf (stderr, "%6lld  ", length);
-
-      print_datime (stderr, modified);
-      fputs ("  ", stderr);
-      print_date (stderr, referenced);
-
-      if (!old)
-	{
-	  int author = (buffer[i+4] >> 9) & 0777;
-	  if (author != 0 && author != 0777)
-	    fprintf (stderr, "  Author %03o", author);
-	}
-
-      int leftovers;
-      fprintf (stderr, "  %d\n",
-	       byte_size (buffer[i+4] & 0777, &leftovers));
+  stats_phase (extract ? "extract" : "list");
+  if (old)
+    list_old (name_beg, extract);
+  else
+    list_new (name_beg, extract);
 
-      if (!old && extract)
-	{
-	  extract_file (filename, &buffer[data+3], length);
-	  timestamps (filename, modified, referenced);
-	}
-    }
+  stats_file (archive);
+  fclose (archive);
+  free (mark);
 
   return 0;
 }
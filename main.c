@@ -15,68 +15,763 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <limits.h>
 #include <string.h>
 #include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <time.h>
+#include <sys/stat.h>
 
 #include "dis.h"
 #include "opcode/pdp10.h"
+#include "cache.h"
 #include "memory.h"
+#include "stats.h"
+#include "symbols.h"
+
+/* Directory for cached images, or NULL. */
+static const char *cache_dir;
+
+/* Where the text printed while loading goes, when the listing isn't
+   text. */
+static FILE *discard;
+
+/* The part of the image to disassemble, from -a or -s. */
+struct range
+{
+  int start;
+  int end;			/* Not included. */
+  const char *symbol;		/* If set, start there. */
+  int count;			/* Words from the symbol, or -1 for
+				   up to the next label. */
+};
 
 static void
 usage (char **argv)
 {
-  fprintf (stderr, "Usage: %s [-6] [-r] [-F<file format>] [-S<symbol mode>] [-W<word format>] [-D<DDT address>] <file>\n\n", argv[0]);
+  fprintf (stderr, "Usage: %s [-6] [-r] [-F<file format>] [-S<symbol mode>] [-W<word format>] [-D<DDT address>] [-j<jobs>] [-a<start>-<end>] [-s<symbol>[+<words>]] [-O<listing format>] [--collapse] [--cache <directory>] [--stats[=json]] <file>\n", argv[0]);
+  fprintf (stderr, "       %s [options] --batch <manifest> --out-dir <directory> [-j<jobs>]\n\n", argv[0]);
   usage_file_format ();
   usage_word_format ();
   usage_symbols_mode ();
+  usage_listing_format ();
   usage_machine ();
   exit (1);
 }
 
+/* Handle an option which may also be given per file in a batch
+   manifest.  Return -1 if it's not valid. */
+static int
+file_option (int opt, const char *arg, int *cpu_model, int *ddt)
+{
+  switch (opt)
+    {
+    case '6':
+      input_file_format = &dmp_file_format;
+      return 0;
+    case 'r':
+      input_file_format = &raw_file_format;
+      return 0;
+    case 'F':
+      return parse_input_file_format (arg);
+    case 'm':
+      return parse_machine (arg, cpu_model);
+    case 'S':
+      return parse_symbols_mode (arg);
+    case 'W':
+      return parse_input_word_format (arg);
+    case 'D':
+      *ddt = strtol (arg, NULL, 8);
+      return 0;
+    case 'C':
+      dis10->collapse = 1;
+      return 0;
+    case 'O':
+      return parse_listing_format (arg);
+    default:
+      return -1;
+    }
+}
+
+static void
+load (FILE *file, struct pdp10_memory *memory, int cpu_model, int ddt)
+{
+  word_t word;
+
+  stats_phase ("load");
+  input_file_format->read (file, memory, cpu_model);
+
+  while ((word = get_word (file)) != -1)
+    fprintf (output_file, "(extra word: %012llo)\n", word);
+  stats_file (file);
+
+  if (ddt)
+    {
+      stats_phase ("ddt");
+      ntsddt_info (memory, ddt);
+    }
+}
+
+/* The text printed while loading, for the cache. */
+struct capture
+{
+  FILE *listing;
+  jmp_buf *failure;
+  FILE *f;
+  char *text;
+  size_t size;
+};
+
+/* Load from the cache if it has the file, or else load it and add it
+   to the cache.  The key has every option which changes what loading
+   prints; the symbol mode does, for the start instruction. */
+static void
+cached_load (FILE *file, struct pdp10_memory *memory, int cpu_model,
+	     int ddt, struct cache_map *map)
+{
+  unsigned long long key;
+  struct capture *c;
+  jmp_buf failure;
+  char options[100];
+  char *path;
+
+  snprintf (options, sizeof options, "%s %s %d %d %o",
+	    input_file_format->name, input_word_format->name,
+	    cpu_model, dis10->symbols_mode, ddt);
+  stats_phase ("cache");
+  path = cache_path (cache_dir, file, options, &key);
+  if (path == NULL)
+    {
+      load (file, memory, cpu_model, ddt);
+      return;
+    }
+
+  if (read_cache (path, key, memory, map) == 0)
+    {
+      free (path);
+      return;
+    }
+
+  c = malloc (sizeof *c);
+  if (c == NULL)
+    {
+      fprintf (stderr, "Out of memory\n");
+      exit (1);
+    }
+  c->listing = dis10->listing;
+  c->failure = dis10->failure;
+  c->f = open_memstream (&c->text, &c->size);
+  if (c->f == NULL)
+    {
+      fprintf (stderr, "Out of memory\n");
+      exit (1);
+    }
+
+  /* An error in the input still has to restore the listing. */
+  dis10->listing = c->f;
+  dis10->failure = &failure;
+  if (setjmp (failure) != 0)
+    {
+      fclose (c->f);
+      free (c->text);
+      dis10->listing = c->listing;
+      dis10->failure = c->failure;
+      free (c);
+      free (path);
+      dis10_fail ();
+    }
+  load (file, memory, cpu_model, ddt);
+  dis10->listing = c->listing;
+  dis10->failure = c->failure;
+  fclose (c->f);
+
+  fwrite (c->text, 1, c->size, output_file);
+  write_cache (path, key, c->text, c->size, memory);
+  free (c->text);
+  free (c);
+  free (path);
+}
+
+static int
+parse_jobs (const char *arg, int *jobs)
+{
+  char *end;
+  long n;
+
+  errno = 0;
+  n = strtol (arg, &end, 10);
+  if (end == arg || *end != 0 || errno != 0 || n < 1 || n > INT_MAX)
+    return -1;
+  *jobs = n;
+  return 0;
+}
+
+static int
+parse_range (int opt, char *arg, struct range *range)
+{
+  char *p, c;
+
+  range->symbol = NULL;
+  range->count = -1;
+  if (opt == 'a')
+    {
+      if (sscanf (arg, "%o-%o%c", &range->start, &range->end, &c) != 2
+	  || range->end < range->start)
+	return -1;
+      range->end++;
+      return 0;
+    }
+
+  p = strchr (arg, '+');
+  if (p != NULL)
+    {
+      *p++ = 0;
+      if (sscanf (p, "%o%c", &range->count, &c) != 1 || range->count < 0)
+	return -1;
+    }
+  range->symbol = arg;
+  return *arg == 0 ? -1 : 0;
+}
+
+/* Find the start and end of a range from a symbol.  Without a count,
+   it ends at the next label, or where the memory does. */
+static void
+symbol_range (struct pdp10_memory *memory, struct range *range)
+{
+  const struct symbol *symbol;
+
+  symbol = get_symbol_by_name (range->symbol);
+  if (symbol == NULL)
+    {
+      fprintf (stderr, "Symbol %s not found\n", range->symbol);
+      dis10_fail ();
+    }
+
+  range->start = symbol->value & 07777777777;
+  if (range->count >= 0)
+    {
+      range->end = range->start + range->count;
+      return;
+    }
+
+  range->end = range->start + 1;
+  while (get_word_at (memory, range->end) != -1
+	 && get_symbol_by_value (range->end, HINT_ADDRESS) == NULL)
+    range->end++;
+}
+
+static void
+disassemble (FILE *file, struct pdp10_memory *memory,
+	     int cpu_model, int ddt, int jobs, struct range *range)
+{
+  struct cache_map map = { NULL, 0 };
+  FILE *listing = dis10->listing;
+
+  if (!input_file_format)
+    guess_input_file_format (file);
+
+  /* Stream when nothing needs the whole image first.  The stages run
+     in threads of their own, which can't fail into a batch job. */
+  if (input_file_format->stream != NULL && !ddt && jobs <= 1
+      && dis10->failure == NULL && cache_dir == NULL && range == NULL
+      && dis10->listing_format == LISTING_TEXT)
+    {
+      stats_phase ("disassemble");
+      input_file_format->stream (file, memory, cpu_model);
+      stats_file (file);
+      return;
+    }
+
+  /* Only the words go into a machine readable listing. */
+  if (dis10->listing_format != LISTING_TEXT)
+    dis10->listing = discard;
+  if (cache_dir != NULL)
+    cached_load (file, memory, cpu_model, ddt, &map);
+  else
+    load (file, memory, cpu_model, ddt);
+  dis10->listing = listing;
+
+  stats_phase ("disassemble");
+  begin_listing (output_file);
+  if (range != NULL)
+    {
+      if (range->symbol != NULL)
+	symbol_range (memory, range);
+      dis_range (memory, range->start, range->end, cpu_model);
+    }
+  else
+    dis_parallel (memory, cpu_model, jobs);
+  close_cache (&map);
+}
+
+/* Batch mode.  Each line of the manifest names a file, along with
+   any of the -6 -r -F -S -W -m -D -O options for it.  The files are
+   disassembled by a pool of threads, each into a file of its own
+   under the output directory.  Files whose output already exists
+   are skipped, so an interrupted run can be resumed.  The largest
+   files are started first, so that they don't hold up the end of
+   the run. */
+
+enum { BATCH_DONE, BATCH_SKIPPED, BATCH_FAILED };
+
+struct batch_entry
+{
+  char *file;
+  char *output;
+  struct dis10_context *context;
+  int cpu_model;
+  int ddt;
+  off_t size;
+  double seconds;
+  int status;
+  const char *error;
+};
+
+struct batch
+{
+  struct batch_entry *entry;
+  int entries;
+  int *order;
+  int next;
+  pthread_mutex_t lock;
+};
+
+static double
+now (void)
+{
+  struct timespec t;
+  clock_gettime (CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void *
+xrealloc (void *ptr, size_t size)
+{
+  ptr = realloc (ptr, size);
+  if (ptr == NULL)
+    {
+      fprintf (stderr, "Out of memory\n");
+      exit (1);
+    }
+  return ptr;
+}
+
+/* The output for a file is its path under the output directory,
+   without empty or "." components.  Return NULL if the path has a
+   ".." component, which could lead out of the directory, or nothing
+   else. */
+static char *
+batch_output (const char *dir, const char *file)
+{
+  char *output, *p;
+  size_t n;
+
+  output = xrealloc (NULL, strlen (dir) + strlen (file) + 6);
+  p = output + sprintf (output, "%s", dir);
+  while (*file != 0)
+    {
+      n = strcspn (file, "/");
+      if (n == 2 && strncmp (file, "..", 2) == 0)
+	{
+	  free (output);
+	  return NULL;
+	}
+      if (n > 0 && !(n == 1 && *file == '.'))
+	{
+	  *p++ = '/';
+	  memcpy (p, file, n);
+	  p += n;
+	}
+      file += n;
+      if (*file == '/')
+	file++;
+    }
+  if (p == output + strlen (dir))
+    {
+      free (output);
+      return NULL;
+    }
+  strcpy (p, ".dis");
+  return output;
+}
+
+static int
+compare_output (const void *a, const void *b)
+{
+  return strcmp (*(char * const *)a, *(char * const *)b);
+}
+
+/* Two entries writing the same output would race for it. */
+static void
+check_outputs (struct batch *batch, const char *manifest)
+{
+  char **output;
+  int i;
+
+  output = xrealloc (NULL, (batch->entries + 1) * sizeof *output);
+  for (i = 0; i < batch->entries; i++)
+    output[i] = batch->entry[i].output;
+  qsort (output, batch->entries, sizeof *output, compare_output);
+  for (i = 1; i < batch->entries; i++)
+    if (strcmp (output[i - 1], output[i]) == 0)
+      {
+	fprintf (stderr, "%s: more than one entry writes %s\n",
+		 manifest, output[i]);
+	exit (1);
+      }
+  free (output);
+}
+
+static int
+make_directories (char *path)
+{
+  char *p;
+
+  for (p = strchr (path + 1, '/'); p != NULL; p = strchr (p + 1, '/'))
+    {
+      *p = 0;
+      if (mkdir (path, 0777) == -1 && errno != EEXIST)
+	{
+	  *p = '/';
+	  return -1;
+	}
+      *p = '/';
+    }
+
+  return 0;
+}
+
+static void
+read_manifest (struct batch *batch, const char *manifest,
+	       int cpu_model, const char *dir)
+{
+  struct dis10_context *defaults = dis10;
+  struct file_format *file_format = input_file_format;
+  struct word_format *word_format = input_word_format;
+  int symbols_mode = dis10->symbols_mode;
+  int collapse = dis10->collapse;
+  int listing_format = dis10->listing_format;
+  struct batch_entry *entry;
+  char *line = NULL, *token, *arg, *save;
+  size_t size = 0;
+  int max = 0, number = 0;
+  struct stat st;
+  FILE *f;
+
+  f = fopen (manifest, "r");
+  if (f == NULL)
+    {
+      fprintf (stderr, "Error opening %s: %s\n", manifest, strerror (errno));
+      exit (1);
+    }
+
+  batch->entries = 0;
+  batch->entry = NULL;
+  while (getline (&line, &size, f) != -1)
+    {
+      number++;
+      token = strtok_r (line, " \t\r\n", &save);
+      if (token == NULL || *token == '#')
+	continue;
+
+      if (batch->entries == max)
+	{
+	  max = max == 0 ? 1024 : 2 * max;
+	  batch->entry = xrealloc (batch->entry, max * sizeof *batch->entry);
+	}
+      entry = &batch->entry[batch->entries++];
+      memset (entry, 0, sizeof *entry);
+      entry->cpu_model = cpu_model;
+
+      /* Options on the command line apply to every file. */
+      entry->context = dis10_new ();
+      dis10_use (entry->context);
+      input_file_format = file_format;
+      input_word_format = word_format;
+      dis10->symbols_mode = symbols_mode;
+      dis10->collapse = collapse;
+      dis10->listing_format = listing_format;
+
+      for (; token != NULL; token = strtok_r (NULL, " \t\r\n", &save))
+	{
+	  if (token[0] != '-')
+	    {
+	      if (entry->file != NULL)
+		goto error;
+	      entry->file = strdup (token);
+	      continue;
+	    }
+	  if (strcmp (token, "--collapse") == 0)
+	    token = "-C";
+	  arg = token + 2;
+	  if (*arg == 0 && strchr ("FmSWDO", token[1]) != NULL)
+	    arg = strtok_r (NULL, " \t\r\n", &save);
+	  if (token[1] == 0 || arg == NULL
+	      || file_option (token[1], arg, &entry->cpu_model, &entry->ddt))
+	    goto error;
+	}
+      if (entry->file == NULL)
+	goto error;
+
+      entry->output = batch_output (dir, entry->file);
+      if (entry->output == NULL)
+	goto error;
+      if (stat (entry->file, &st) == 0)
+	entry->size = st.st_size;
+    }
+
+  dis10_use (defaults);
+  free (line);
+  fclose (f);
+  check_outputs (batch, manifest);
+  return;
+
+ error:
+  fprintf (stderr, "%s:%d: invalid manifest line\n", manifest, number);
+  exit (1);
+}
+
+static void
+batch_file (struct batch_entry *entry)
+{
+  struct pdp10_memory memory;
+  jmp_buf failure;
+  char *temporary;
+  FILE *file, *output;
+
+  if (access (entry->output, F_OK) == 0)
+    {
+      entry->status = BATCH_SKIPPED;
+      return;
+    }
+
+  entry->status = BATCH_FAILED;
+  file = fopen (entry->file, "rb");
+  if (file == NULL)
+    {
+      entry->error = strerror (errno);
+      return;
+    }
+
+  /* Write to a temporary file, so that an interrupted run doesn't
+     leave a partial output that a later run would skip. */
+  temporary = xrealloc (NULL, strlen (entry->output) + 5);
+  sprintf (temporary, "%s.tmp", entry->output);
+  output = NULL;
+  if (make_directories (temporary) == 0)
+    output = fopen (temporary, "w");
+  if (output == NULL)
+    {
+      entry->error = strerror (errno);
+      fclose (file);
+      free (temporary);
+      return;
+    }
+
+  /* Errors in the input end up back here. */
+  init_memory (&memory);
+  dis10->listing = output;
+  dis10->failure = &failure;
+  if (setjmp (failure) == 0)
+    {
+      disassemble (file, &memory, entry->cpu_model, entry->ddt, 1, NULL);
+      entry->status = BATCH_DONE;
+    }
+  else
+    entry->error = "invalid input";
+  dis10->failure = NULL;
+  dis10->listing = NULL;
+  free_memory (&memory);
+  fclose (file);
+
+  if (fclose (output) != 0)
+    {
+      entry->status = BATCH_FAILED;
+      entry->error = strerror (errno);
+    }
+  if (entry->status != BATCH_DONE || rename (temporary, entry->output) != 0)
+    {
+      if (entry->error == NULL)
+	entry->error = strerror (errno);
+      entry->status = BATCH_FAILED;
+      remove (temporary);
+    }
+  free (temporary);
+}
+
+static void *
+batch_worker (void *arg)
+{
+  struct batch *batch = arg;
+  struct batch_entry *entry;
+  double start;
+
+  for (;;)
+    {
+      pthread_mutex_lock (&batch->lock);
+      if (batch->next == batch->entries)
+	{
+	  pthread_mutex_unlock (&batch->lock);
+	  return NULL;
+	}
+      entry = &batch->entry[batch->order[batch->next++]];
+      pthread_mutex_unlock (&batch->lock);
+
+      start = now ();
+      dis10_use (entry->context);
+      batch_file (entry);
+      dis10_use (NULL);
+      dis10_free (entry->context);
+      entry->context = NULL;
+      entry->seconds = now () - start;
+    }
+}
+
+static struct batch *sorting;
+
+static int
+compare_size (const void *a, const void *b)
+{
+  off_t sa = sorting->entry[*(const int *)a].size;
+  off_t sb = sorting->entry[*(const int *)b].size;
+
+  if (sa != sb)
+    return sa > sb ? -1 : 1;
+  return *(const int *)a - *(const int *)b;
+}
+
+static int
+run_batch (const char *manifest, const char *dir, int cpu_model, int jobs)
+{
+  static const char *status[] = { "done", "skipped", "FAILED" };
+  struct batch batch;
+  struct batch_entry *entry;
+  int count[3] = { 0, 0, 0 };
+  pthread_t *thread;
+  double start;
+  int i;
+
+  read_manifest (&batch, manifest, cpu_model, dir);
+
+  batch.order = xrealloc (NULL, (batch.entries + 1) * sizeof (int));
+  for (i = 0; i < batch.entries; i++)
+    batch.order[i] = i;
+  sorting = &batch;
+  qsort (batch.order, batch.entries, sizeof (int), compare_size);
+  batch.next = 0;
+  pthread_mutex_init (&batch.lock, NULL);
+
+  if (jobs > batch.entries)
+    jobs = batch.entries;
+  thread = xrealloc (NULL, (jobs + 1) * sizeof (pthread_t));
+
+  start = now ();
+  stats_phase ("batch");
+  for (i = 0; i < jobs; i++)
+    {
+      if (pthread_create (&thread[i], NULL, batch_worker, &batch) != 0)
+	{
+	  fprintf (stderr, "Error creating thread\n");
+	  exit (1);
+	}
+    }
+  for (i = 0; i < jobs; i++)
+    pthread_join (thread[i], NULL);
+  stats_phase (NULL);
+
+  for (i = 0; i < batch.entries; i++)
+    {
+      entry = &batch.entry[i];
+      count[entry->status]++;
+      printf ("%9.3f  %-7s  %s", entry->seconds, status[entry->status],
+	      entry->file);
+      if (entry->error)
+	printf (": %s", entry->error);
+      printf ("\n");
+      free (entry->file);
+      free (entry->output);
+    }
+  printf ("%d done, %d skipped, %d failed in %.3f seconds\n",
+	  count[BATCH_DONE], count[BATCH_SKIPPED], count[BATCH_FAILED],
+	  now () - start);
+
+  pthread_mutex_destroy (&batch.lock);
+  free (thread);
+  free (batch.order);
+  free (batch.entry);
+  return count[BATCH_FAILED] > 0;
+}
+
 int
 main (int argc, char **argv)
 {
+  static const struct option long_options[] = {
+    { "batch", required_argument, NULL, 'B' },
+    { "out-dir", required_argument, NULL, 'o' },
+    { "collapse", no_argument, NULL, 'C' },
+    { "cache", required_argument, NULL, 'K' },
+    { NULL, 0, NULL, 0 }
+  };
   int cpu_model = PDP10_KA10_ITS;
   struct pdp10_memory memory;
+  struct range range, *part = NULL;
+  const char *manifest = NULL;
+  const char *dir = NULL;
   FILE *file;
-  word_t word;
   int opt;
   int ddt = 0;
+  int jobs = 1;
+
+  if (parse_stats_option (&argc, argv))
+    usage (argv);
 
-  while ((opt = getopt (argc, argv, "6rF:S:W:m:D:")) != -1)
+  while ((opt = getopt_long (argc, argv, "6rF:S:W:m:D:j:a:s:O:",
+			     long_options, NULL)) != -1)
     {
       switch (opt)
 	{
-	case '6':
-	  input_file_format = &dmp_file_format;
+	case 'B':
+	  manifest = optarg;
 	  break;
-	case 'r':
-	  input_file_format = &raw_file_format;
+	case 'o':
+	  dir = optarg;
 	  break;
-	case 'F':
-	  if (parse_input_file_format (optarg))
-	    usage (argv);
-	  break;
-	case 'm':
-	  if (parse_machine (optarg, &cpu_model))
-	    usage (argv);
+	case 'K':
+	  cache_dir = optarg;
 	  break;
-	case 'S':
-	  if (parse_symbols_mode (optarg))
+	case 'j':
+	  if (parse_jobs (optarg, &jobs))
 	    usage (argv);
 	  break;
-	case 'W':
-	  if (parse_input_word_format (optarg))
+	case 'a':
+	case 's':
+	  if (parse_range (opt, optarg, &range))
 	    usage (argv);
-	  break;
-	case 'D':
-	  ddt = strtol (optarg, NULL, 8);
+	  part = &range;
 	  break;
 	default:
-	  usage (argv);
+	  if (file_option (opt, optarg, &cpu_model, &ddt))
+	    usage (argv);
 	}
     }
 
+  discard = fopen ("/dev/null", "w");
+  if (discard == NULL)
+    {
+      fprintf (stderr, "%s: Error opening /dev/null: %s\n",
+	       argv[0], strerror (errno));
+      return 1;
+    }
+
+  if (manifest != NULL)
+    {
+      if (dir == NULL || optind != argc || part != NULL)
+	usage (argv);
+      return run_batch (manifest, dir, cpu_model, jobs);
+    }
+
   if (optind != argc - 1)
     usage (argv);
 
@@ -89,19 +784,7 @@ main (int argc, char **argv)
     }
 
   init_memory (&memory);
-
-  if (!input_file_format)
-    guess_input_file_format (file);
-  input_file_format->read (file, &memory, cpu_model);
-
-  while ((word = get_word (file)) != -1)
-    printf ("(extra word: %012llo)\n", word);
-
-  if (ddt)
-    ntsddt_info (&memory, ddt);
-
-  printf ("\nDisassembly:\n\n");
-  dis (&memory, cpu_model);
+  disassemble (file, &memory, cpu_model, ddt, jobs, part);
 
   return 0;
 }
@@ -16,67 +16,232 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "memory.h"
+#include "stats.h"
+
+/* Chunks hold at least a moby. */
+#define CHUNK_WORDS (256 * 1024)
+
+static int *
+page_entry (struct pdp10_memory *memory, int address)
+{
+  int *pages;
+
+  if (memory->section == NULL || address < 0
+      || address >= (1 << MEMORY_ADDRESS_BITS))
+    return NULL;
+  pages = memory->section[address >> MEMORY_SECTION_BITS];
+  if (pages == NULL)
+    return NULL;
+  return &pages[(address >> MEMORY_PAGE_BITS) & (MEMORY_PAGES - 1)];
+}
 
 static struct pdp10_area *
 find_area (struct pdp10_memory *memory, int address)
 {
-  int i, j, k;
+  int *entry = page_entry (memory, address);
+  int i;
 
-  if (memory->areas == 0)
+  if (entry == NULL || *entry == 0)
     return NULL;
 
-  i = 0;
-  j = memory->areas - 1;
+  /* Usually the first area in the page is the one. */
+  for (i = *entry - 1;
+       i < memory->areas && memory->area[i].start <= address;
+       i++)
+    if (address < memory->area[i].end)
+      return &memory->area[i];
 
-  while (i <= j)
+  return NULL;
+}
+
+/* Enter area number n in the page directory.  When it was inserted
+   before other areas, their numbers go up by one first. */
+static int
+map_area (struct pdp10_memory *memory, int n)
+{
+  struct pdp10_area *area = &memory->area[n];
+  int *pages;
+  int i, j, page;
+
+  if (memory->section == NULL)
     {
-      k = (i + j) / 2;
-
-      if (address < memory->area[k].start)
-	j = k - 1;
-      else if (address >= memory->area[k].end)
-	i = k + 1;
-      else
-	return &memory->area[k];
+      memory->section = calloc (MEMORY_SECTIONS, sizeof *memory->section);
+      if (memory->section == NULL)
+	return -1;
     }
 
-  return NULL;
+  if (n < memory->areas - 1)
+    for (i = 0; i < MEMORY_SECTIONS; i++)
+      if ((pages = memory->section[i]) != NULL)
+	for (j = 0; j < MEMORY_PAGES; j++)
+	  if (pages[j] > n)
+	    pages[j]++;
+
+  for (page = area->start >> MEMORY_PAGE_BITS;
+       page <= (area->end - 1) >> MEMORY_PAGE_BITS;
+       page++)
+    {
+      i = page >> (MEMORY_SECTION_BITS - MEMORY_PAGE_BITS);
+      if (memory->section[i] == NULL)
+	{
+	  memory->section[i] = calloc (MEMORY_PAGES, sizeof (int));
+	  if (memory->section[i] == NULL)
+	    return -1;
+	}
+      pages = &memory->section[i][page & (MEMORY_PAGES - 1)];
+      if (*pages == 0 || *pages > n + 1)
+	*pages = n + 1;
+    }
+
+  return 0;
+}
+
+static int last_generation = 0;
+
+static int
+new_generation (void)
+{
+  return __sync_add_and_fetch (&last_generation, 1);
 }
 
 void
 init_memory (struct pdp10_memory *memory)
 {
   memory->areas = 0;
+  memory->max_areas = 0;
   memory->area = NULL;
   memory->current_area = NULL;
   memory->current_address = 0;
+  memory->section = NULL;
+  memory->chunks = NULL;
+  memory->current_chunk = NULL;
+  memory->generation = new_generation ();
+  memory->load = NULL;
+  memory->load_data = NULL;
 }
 
 int
 add_memory (struct pdp10_memory *memory, int address, int length, word_t *data)
 {
   struct pdp10_area *area;
+  int i, n;
 
   if (find_area (memory, address) != NULL)
     return -2;
 
-  memory->areas++;
-  area = realloc (memory->area, memory->areas * sizeof (struct pdp10_area));
-  if (area == NULL)
+  /* The page directory only covers addresses below 2^30. */
+  if (address < 0 || length < 0
+      || length > (1 << MEMORY_ADDRESS_BITS) - address)
+    return -1;
+
+  if (memory->areas == memory->max_areas)
     {
-      memory->areas--;
-      return -1;
+      n = memory->max_areas == 0 ? 16 : 2 * memory->max_areas;
+      area = realloc (memory->area, n * sizeof (struct pdp10_area));
+      if (area == NULL)
+	return -1;
+      memory->area = area;
+      memory->max_areas = n;
     }
-  memory->area = area;
 
-  area = &memory->area[memory->areas - 1];
+  /* Keep the areas sorted.  They usually come in order. */
+  for (i = memory->areas; i > 0 && memory->area[i - 1].start > address; i--)
+    memory->area[i] = memory->area[i - 1];
+  memory->areas++;
+
+  area = &memory->area[i];
   area->start = address;
   area->end = address + length;
   area->data = data;
+  memory->generation = new_generation ();
 
+  if (map_area (memory, i) != 0)
+    return -1;
+  STATS_ADD (STATS_AREAS, 1);
   return 0;
 }
 
+/* Allocate words for an area from the current chunk, or failing
+   that the next one with room, or a new one.  After clear_memory, the
+   old chunks are used again before any new ones. */
+word_t *
+alloc_words (struct pdp10_memory *memory, int n)
+{
+  struct pdp10_chunk *chunk = memory->current_chunk;
+  struct pdp10_chunk **next;
+  int size;
+
+  while (chunk != NULL && chunk->size - chunk->used < n)
+    chunk = chunk->next;
+
+  if (chunk == NULL)
+    {
+      size = n > CHUNK_WORDS ? n : CHUNK_WORDS;
+      chunk = malloc (sizeof *chunk + size * sizeof (word_t));
+      if (chunk == NULL)
+	return NULL;
+      chunk->next = NULL;
+      chunk->size = size;
+      chunk->used = 0;
+      for (next = &memory->chunks; *next != NULL; next = &(*next)->next)
+	;
+      *next = chunk;
+    }
+
+  memory->current_chunk = chunk;
+  chunk->used += n;
+  return &chunk->data[chunk->used - n];
+}
+
+/* Shrink the last allocation to n words. */
+void
+trim_words (struct pdp10_memory *memory, word_t *data, int n)
+{
+  struct pdp10_chunk *chunk = memory->current_chunk;
+
+  chunk->used = data - chunk->data + n;
+}
+
+/* Forget all areas, but keep the chunks for loading another image. */
+void
+clear_memory (struct pdp10_memory *memory)
+{
+  struct pdp10_chunk *chunk;
+  int i;
+
+  for (chunk = memory->chunks; chunk != NULL; chunk = chunk->next)
+    chunk->used = 0;
+  memory->current_chunk = memory->chunks;
+
+  if (memory->section != NULL)
+    for (i = 0; i < MEMORY_SECTIONS; i++)
+      {
+	free (memory->section[i]);
+	memory->section[i] = NULL;
+      }
+
+  memory->areas = 0;
+  memory->current_area = NULL;
+  memory->current_address = 0;
+  memory->generation = new_generation ();
+}
+
+void
+free_memory (struct pdp10_memory *memory)
+{
+  struct pdp10_chunk *chunk, *next;
+
+  clear_memory (memory);
+  for (chunk = memory->chunks; chunk != NULL; chunk = next)
+    {
+      next = chunk->next;
+      free (chunk);
+    }
+  free (memory->section);
+  free (memory->area);
+  init_memory (memory);
+}
+
 int
 set_address (struct pdp10_memory *memory, int address)
 {
@@ -99,6 +264,39 @@ set_address (struct pdp10_memory *memory, int address)
   return 0;
 }
 
+/* Make get_next_word return the first word at or after an address
+   next.  Return -1 if there is none. */
+int
+seek_address (struct pdp10_memory *memory, int address)
+{
+  struct pdp10_area *area;
+  int low, high, middle;
+
+  area = find_area (memory, address);
+  if (area == NULL)
+    {
+      /* The first area after the address. */
+      low = 0;
+      high = memory->areas;
+      while (low < high)
+	{
+	  middle = (low + high) / 2;
+	  if (memory->area[middle].start <= address)
+	    low = middle + 1;
+	  else
+	    high = middle;
+	}
+      if (low == memory->areas)
+	return -1;
+      area = &memory->area[low];
+      address = area->start;
+    }
+
+  memory->current_area = area;
+  memory->current_address = address - 1;
+  return 0;
+}
+
 int
 get_address (struct pdp10_memory *memory)
 {
@@ -144,7 +342,7 @@ get_word_at (struct pdp10_memory *memory, int address)
 
   area = find_area (memory, address);
   if (area == NULL)
-    return -1;
+    return memory->load != NULL ? memory->load (memory, address) : -1;
 
   return getword (area, address);
 }
@@ -25,18 +25,51 @@ struct pdp10_area
   word_t *data;
 };
 
+/* Loaded words are allocated from chunks owned by the memory. */
+struct pdp10_chunk
+{
+  struct pdp10_chunk *	next;
+  int			size;
+  int			used;
+  word_t		data[];
+};
+
+/* Addresses are split into section, page, and word.  KL10 extended
+   addresses have 12 bits of section. */
+#define MEMORY_ADDRESS_BITS	30
+#define MEMORY_SECTION_BITS	18
+#define MEMORY_PAGE_BITS	9
+#define MEMORY_SECTIONS		(1 << (MEMORY_ADDRESS_BITS - MEMORY_SECTION_BITS))
+#define MEMORY_PAGES		(1 << (MEMORY_SECTION_BITS - MEMORY_PAGE_BITS))
+
 struct pdp10_memory
 {
-  int			areas;
+  int			areas;		/* Sorted by start address. */
+  int			max_areas;
   struct pdp10_area *	area;
   struct pdp10_area *	current_area;
   int			current_address;
+  /* For each page, one more than the index of the first area in it,
+     or zero.  Sections are allocated when first used. */
+  int **		section;
+  struct pdp10_chunk *	chunks;
+  struct pdp10_chunk *	current_chunk;
+  int			generation;	/* Changes with the contents. */
+  /* If set, called for an address outside all areas.  Returns the
+     word there, or -1. */
+  word_t	     (*	load) (struct pdp10_memory *, int address);
+  void *		load_data;
 };
 
 extern void	init_memory (struct pdp10_memory *memory);
 extern int	add_memory (struct pdp10_memory *memory,
 			    int address, int length, word_t *data);
+extern word_t *	alloc_words (struct pdp10_memory *memory, int n);
+extern void	trim_words (struct pdp10_memory *memory, word_t *data, int n);
+extern void	clear_memory (struct pdp10_memory *memory);
+extern void	free_memory (struct pdp10_memory *memory);
 extern int	set_address (struct pdp10_memory *memory, int address);
+extern int	seek_address (struct pdp10_memory *memory, int address);
 extern int	get_address (struct pdp10_memory *memory);
 extern word_t	get_next_word (struct pdp10_memory *memory);
 extern word_t	get_word_at (struct pdp10_memory *memory, int address);
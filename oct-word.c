@@ -23,7 +23,7 @@
 static word_t
 get_oct_word (FILE *f)
 {
-  static char line[100];
+  char line[100];
   word_t word;
   char *p;
   int i;
@@ -65,5 +65,7 @@ struct word_format oct_word_format = {
   get_oct_word,
   NULL,
   write_oct_word,
+  NULL,
+  NULL,
   NULL
 };
@@ -69,5 +69,7 @@ struct word_format pt_word_format = {
   get_pt_word,
   NULL,
   write_pt_word,
+  NULL,
+  NULL,
   NULL
 };
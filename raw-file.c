@@ -22,32 +22,57 @@
 void
 read_raw_at (FILE *f, struct pdp10_memory *memory, int address)
 {
-  word_t word;
+  word_t *data;
+  int n;
 
-  while ((word = get_word (f)) != -1)
+  for (;;)
     {
-      word_t *data = malloc (sizeof *data);
+      data = alloc_words (memory, ITS_PAGESIZE);
       if (data == NULL)
 	{
 	  fprintf (stderr, "out of memory\n");
 	  exit (1);
 	}
 
-      data[0] = word;
+      n = get_words (f, data, ITS_PAGESIZE);
+      trim_words (memory, data, n);
+      if (n == 0)
+	break;
 
-      add_memory (memory, address++, 1, data);
+      add_memory (memory, address, n, data);
+      address += n;
     }
 }
 
 static void
 read_raw (FILE *f, struct pdp10_memory *memory, int cpu_model)
 {
-  printf ("Raw format\n");
+  fprintf (output_file, "Raw format\n");
 
   read_raw_at (f, memory, 0);
 }
 
+/* A file which can't be read again where the window misses is
+   loaded as usual. */
+static void
+stream_raw (FILE *f, struct pdp10_memory *memory, int cpu_model)
+{
+  if (fseek (f, 0, SEEK_CUR) != 0)
+    {
+      read_raw (f, memory, cpu_model);
+      fprintf (output_file, "\nDisassembly:\n\n");
+      dis (memory, cpu_model);
+      return;
+    }
+
+  fprintf (output_file, "Raw format\n");
+  fprintf (output_file, "\nDisassembly:\n\n");
+
+  dis_stream (f, memory, 0, cpu_model);
+}
+
 struct file_format raw_file_format = {
   "raw",
-  read_raw
+  read_raw,
+  stream_raw
 };
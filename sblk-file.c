@@ -28,7 +28,7 @@ read_sblk (FILE *f, struct pdp10_memory *memory, int cpu_model)
 
   int block_length, block_address;
 
-  printf ("SBLK format\n");
+  fprintf (output_file, "SBLK format\n");
 
   address = 0;
   while ((word = get_word (f)) != JRST_1)
@@ -38,7 +38,7 @@ read_sblk (FILE *f, struct pdp10_memory *memory, int cpu_model)
 	{
 	  fprintf (stderr, "JRST 1 instruction not found in the first "
 		   "100 words\n");
-	  exit (1);
+	  dis10_fail ();
 	}
     }
       
@@ -50,7 +50,7 @@ read_sblk (FILE *f, struct pdp10_memory *memory, int cpu_model)
       block_length = -((word >> 18) | ((-1) & ~0777777));
       block_address = word & 0777777;
 
-      data = malloc (block_length * sizeof *data);
+      data = alloc_words (memory, block_length);
       if (data == NULL)
 	{
 	  fprintf (stderr, "out of memory\n");
@@ -69,11 +69,12 @@ read_sblk (FILE *f, struct pdp10_memory *memory, int cpu_model)
       check_checksum (word);
     }
 
-  printf ("\n");
+  fprintf (output_file, "\n");
   sblk_info (f, word, cpu_model);
 }
 
 struct file_format sblk_file_format = {
   "sblk",
-  read_sblk
+  read_sblk,
+  NULL
 };
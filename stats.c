@@ -0,0 +1,192 @@
+/* Copyright (C) 2026 Lars Brinkhoff <lars@nocrew.org>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "stats.h"
+
+int stats_enabled = 0;
+long long stats_count[STATS_COUNTERS];
+
+static int json;
+
+static const char *counter_name[STATS_COUNTERS] = {
+  "bytes_read",
+  "words_decoded",
+  "areas",
+  "symbols",
+  "symbol_lookups",
+  "symbols_resolved",
+  "instructions",
+  "indirection_loops"
+};
+
+/* A phase is a named part of the run.  Only one phase is timed at a
+   time, and time spent in a phase which is entered again adds up.
+   Phases are only timed on the main thread; other threads may run
+   the same code, as in dis10 --batch, but don't start phases. */
+#define MAX_PHASES 16
+
+struct phase {
+  const char *name;
+  double wall;
+  double cpu;
+};
+
+static struct phase phases[MAX_PHASES];
+static int num_phases = 0;
+static struct phase *current;
+static double start_wall, start_cpu;
+static __thread int main_thread;
+
+static double
+seconds (clockid_t clock)
+{
+  struct timespec t;
+  clock_gettime (clock, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void
+print_at_exit (void)
+{
+  print_stats (stderr);
+}
+
+/* Look for --stats or --stats=json in the arguments, and remove it.
+   Statistics are printed to stderr when the program exits.  Return
+   -1 for an unknown --stats argument. */
+int
+parse_stats_option (int *argc, char **argv)
+{
+  int i, j;
+
+  for (i = j = 1; i < *argc; i++)
+    {
+      if (strcmp (argv[i], "--") == 0)
+	{
+	  while (i < *argc)
+	    argv[j++] = argv[i++];
+	  break;
+	}
+      else if (strcmp (argv[i], "--stats") == 0)
+	stats_enabled = 1;
+      else if (strcmp (argv[i], "--stats=json") == 0)
+	stats_enabled = json = 1;
+      else if (strncmp (argv[i], "--stats=", 8) == 0)
+	return -1;
+      else
+	argv[j++] = argv[i];
+    }
+  argv[j] = NULL;
+  *argc = j;
+
+  if (stats_enabled)
+    {
+      main_thread = 1;
+      atexit (print_at_exit);
+      stats_phase ("startup");
+    }
+
+  return 0;
+}
+
+/* End the current phase, and start timing the named one.  A NULL
+   name just ends the current phase. */
+void
+stats_phase (const char *name)
+{
+  double wall, cpu;
+  int i;
+
+  if (!stats_enabled || !main_thread)
+    return;
+
+  wall = seconds (CLOCK_MONOTONIC);
+  cpu = seconds (CLOCK_PROCESS_CPUTIME_ID);
+  if (current != NULL)
+    {
+      current->wall += wall - start_wall;
+      current->cpu += cpu - start_cpu;
+      current = NULL;
+    }
+  if (name == NULL)
+    return;
+
+  for (i = 0; i < num_phases; i++)
+    if (strcmp (phases[i].name, name) == 0)
+      break;
+  if (i == num_phases)
+    {
+      if (num_phases == MAX_PHASES)
+	return;
+      phases[num_phases++].name = name;
+    }
+
+  current = &phases[i];
+  start_wall = wall;
+  start_cpu = cpu;
+}
+
+/* Count the bytes read from a file, if it can tell. */
+void
+stats_file (FILE *f)
+{
+  long n;
+
+  if (!stats_enabled)
+    return;
+
+  n = ftell (f);
+  if (n > 0)
+    STATS_ADD (STATS_BYTES, n);
+}
+
+void
+print_stats (FILE *f)
+{
+  struct rusage usage;
+  long rss = 0;
+  int i;
+
+  stats_phase (NULL);
+  if (getrusage (RUSAGE_SELF, &usage) == 0)
+    rss = usage.ru_maxrss;
+
+  if (json)
+    {
+      fprintf (f, "{");
+      for (i = 0; i < STATS_COUNTERS; i++)
+	fprintf (f, "\"%s\": %lld, ", counter_name[i], stats_count[i]);
+      fprintf (f, "\"phases\": {");
+      for (i = 0; i < num_phases; i++)
+	fprintf (f, "%s\"%s\": {\"wall\": %.6f, \"cpu\": %.6f}",
+		 i == 0 ? "" : ", ",
+		 phases[i].name, phases[i].wall, phases[i].cpu);
+      fprintf (f, "}, \"peak_rss_kb\": %ld}\n", rss);
+      return;
+    }
+
+  fprintf (f, "Statistics:\n");
+  for (i = 0; i < STATS_COUNTERS; i++)
+    fprintf (f, "  %-18s %12lld\n", counter_name[i], stats_count[i]);
+  for (i = 0; i < num_phases; i++)
+    fprintf (f, "  %-18s %9.3f s wall %9.3f s cpu\n",
+	     phases[i].name, phases[i].wall, phases[i].cpu);
+  fprintf (f, "  %-18s %12ld kB\n", "peak_rss", rss);
+}
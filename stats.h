@@ -0,0 +1,49 @@
+/* Copyright (C) 2026 Lars Brinkhoff <lars@nocrew.org>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+enum {
+  STATS_BYTES,			/* Bytes read from input files. */
+  STATS_WORDS,			/* Words decoded by get_word. */
+  STATS_AREAS,			/* Memory areas added. */
+  STATS_SYMBOLS,		/* Symbols added. */
+  STATS_LOOKUPS,		/* Symbol lookups by value. */
+  STATS_RESOLVED,		/* Lookups not answered by the cache. */
+  STATS_INSTRUCTIONS,		/* Words disassembled. */
+  STATS_LOOPS,			/* Indirection loops found. */
+  STATS_COUNTERS
+};
+
+extern int stats_enabled;
+extern long long stats_count[STATS_COUNTERS];
+
+/* Counters are only touched when statistics are on, and may be
+   updated from several threads. */
+#define STATS_ADD(counter, n)					\
+  do {								\
+    if (stats_enabled)						\
+      __sync_fetch_and_add (&stats_count[counter], (n));	\
+  } while (0)
+
+extern int	parse_stats_option (int *argc, char **argv);
+extern void	stats_phase (const char *name);
+extern void	stats_file (FILE *f);
+extern void	print_stats (FILE *f);
+
+#endif
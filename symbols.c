@@ -20,11 +20,53 @@
 #include <string.h>
 
 #include "dis.h"
+#include "stats.h"
 #include "symbols.h"
 
-#define MAX_SYMBOLS 16384
+/* Symbols are kept in the order they were added.  There are two
+   indices into them: a hash table by name, which holds the most
+   visible symbol of each name, and an array sorted by value.  New
+   symbols are sorted and merged into the value index at the next
+   lookup by value, so adding symbols never re-sorts the whole table.
+   Each context has its own table, made on the first symbol added. */
+struct symbol_table {
+  struct symbol *symbols;
+  int num_symbols;
+  int max_symbols;
+
+  int *name_hash;
+  int hash_size;
+  int hash_used;
+
+  int *by_value;
+  int num_by_value;
+  int max_by_value;
+
+  /* Names are interned in blocks which are never moved, and only
+     freed with the table. */
+  struct name_block *blocks;
+  char *arena;
+  size_t arena_left;
+
+  /* Changed whenever the answer to a lookup by value may change.
+     Generations are unique across all tables. */
+  int generation;
+};
+
+struct name_block {
+  struct name_block *next;
+  char names[];
+};
+
+#define NAME_BLOCK 65536
+
+static int last_generation = 0;
 
-static int symbols_mode = SYMBOLS_NONE;
+static int
+new_generation (void)
+{
+  return __sync_add_and_fetch (&last_generation, 1);
+}
 
 void
 usage_symbols_mode (void)
@@ -36,84 +78,163 @@ int
 parse_symbols_mode (const char *string)
 {
   if (strcmp (string, "none") == 0)
-    symbols_mode = SYMBOLS_NONE;
+    dis10->symbols_mode = SYMBOLS_NONE;
   else if (strcmp (string, "ddt") == 0)
-    symbols_mode = SYMBOLS_DDT;
+    dis10->symbols_mode = SYMBOLS_DDT;
   else if (strcmp (string, "all") == 0)
-    symbols_mode = SYMBOLS_ALL;
+    dis10->symbols_mode = SYMBOLS_ALL;
   else
     return -1;
 
+  if (dis10->symbols != NULL)
+    dis10->symbols->generation = new_generation ();
   return 0;
 }
 
-static struct symbol symbols[MAX_SYMBOLS];
-static int num_symbols = 0;
+static struct symbol_table *
+symbol_table (void)
+{
+  struct symbol_table *t = dis10->symbols;
+
+  if (t == NULL)
+    {
+      t = calloc (1, sizeof *t);
+      if (t == NULL)
+	{
+	  fprintf (stderr, "Out of memory\n");
+	  exit (1);
+	}
+      t->generation = new_generation ();
+      dis10->symbols = t;
+    }
 
-typedef enum {
-  SORT_NONE,
-  SORT_NAME,
-  SORT_VALUE
-} sort_mode_t;
-static sort_mode_t sorted = SORT_NONE;
+  return t;
+}
 
 void
-add_symbol (const char *name, word_t value, int flags)
+free_symbol_table (struct symbol_table *t)
 {
-  int i = num_symbols++;
-  char *p;
+  struct name_block *block, *next;
+
+  if (t == NULL)
+    return;
 
-  if (num_symbols > MAX_SYMBOLS)
+  for (block = t->blocks; block != NULL; block = next)
     {
-      fprintf (stderr, "Too many symbols\n");
-      exit (1);
+      next = block->next;
+      free (block);
     }
+  free (t->symbols);
+  free (t->name_hash);
+  free (t->by_value);
+  free (t);
+}
 
-  /* Copy the name, with trailing spaces stripped off. */
-  p = strdup (name);
-  symbols[i].name = p;
-  while (*p)
-    p++;
-  while (p > symbols[i].name && *(p - 1) == ' ')
-    *--p = '\0';
-
-  symbols[i].value = value;
-  symbols[i].sequence = num_symbols;
-  symbols[i].flags = flags;
+static void *
+grow (void *array, int *size, size_t element, int minimum)
+{
+  int n = *size == 0 ? minimum : 2 * *size;
 
-  sorted = SORT_NONE;
+  array = realloc (array, n * element);
+  if (array == NULL)
+    {
+      fprintf (stderr, "Out of memory\n");
+      exit (1);
+    }
+  *size = n;
+  return array;
 }
 
-/* When searching symbols, we can't assume that anything other than
-   the field we're searching for is valid, as one of the arguments
-   might be the key. */
+static unsigned
+hash_name (const char *name, size_t length)
+{
+  unsigned h = 2166136261U;
+  size_t i;
+
+  for (i = 0; i < length; i++)
+    h = (h ^ (unsigned char)name[i]) * 16777619U;
+  return h;
+}
 
+/* Return the hash table slot for a name: either the slot of the
+   symbol with that name, or the empty slot where it would go. */
 static int
-compare_name_search (const void *a, const void *b)
+find_name (struct symbol_table *t, const char *name, size_t length)
 {
-  const struct symbol *sa = a;
-  const struct symbol *sb = b;
+  int i = hash_name (name, length) & (t->hash_size - 1);
+  const char *p;
 
-  return strcmp (sa->name, sb->name);
+  while (t->name_hash[i] != -1)
+    {
+      p = t->symbols[t->name_hash[i]].name;
+      if (strncmp (p, name, length) == 0 && p[length] == '\0')
+	break;
+      i = (i + 1) & (t->hash_size - 1);
+    }
+
+  return i;
 }
 
-static int
-compare_value_search (const void *a, const void *b)
+static void
+rehash (struct symbol_table *t)
 {
-  const struct symbol *sa = a;
-  const struct symbol *sb = b;
+  int *old = t->name_hash;
+  int old_size = t->hash_size;
+  const char *name;
+  int i, j;
+
+  t->hash_size = t->hash_size == 0 ? 1024 : 2 * t->hash_size;
+  t->name_hash = malloc (t->hash_size * sizeof *t->name_hash);
+  if (t->name_hash == NULL)
+    {
+      fprintf (stderr, "Out of memory\n");
+      exit (1);
+    }
+  for (i = 0; i < t->hash_size; i++)
+    t->name_hash[i] = -1;
+
+  for (i = 0; i < old_size; i++)
+    if (old[i] != -1)
+      {
+	name = t->symbols[old[i]].name;
+	j = find_name (t, name, strlen (name));
+	t->name_hash[j] = old[i];
+      }
+
+  free (old);
+}
 
-  if (sa->value == sb->value)
-    return 0;
-  else if (sa->value < sb->value)
-    return -1;
-  else
-    return 1;
+static const char *
+intern (struct symbol_table *t, const char *name, size_t length)
+{
+  char *p;
+
+  struct name_block *block;
+
+  if (length + 1 > t->arena_left)
+    {
+      t->arena_left = length + 1 > NAME_BLOCK ? length + 1 : NAME_BLOCK;
+      block = malloc (sizeof *block + t->arena_left);
+      if (block == NULL)
+	{
+	  fprintf (stderr, "Out of memory\n");
+	  exit (1);
+	}
+      block->next = t->blocks;
+      t->blocks = block;
+      t->arena = block->names;
+    }
+
+  p = t->arena;
+  memcpy (p, name, length);
+  p[length] = '\0';
+  t->arena += length + 1;
+  t->arena_left -= length + 1;
+  return p;
 }
 
-/* When sorting, all the fields are valid. Order first by the key we're
-   sorting by, then by visibility so the most visible symbols come
-   first, then by their original declaration order. */
+/* Order symbols with the same key by visibility so the most visible
+   symbols come first, then by their original declaration order. */
 
 static int
 concealment (const struct symbol *s)
@@ -126,11 +247,8 @@ concealment (const struct symbol *s)
 }
 
 static int
-compare_default (const void *a, const void *b)
+compare_default (const struct symbol *sa, const struct symbol *sb)
 {
-  const struct symbol *sa = a;
-  const struct symbol *sb = b;
-
   int r = concealment (sa) - concealment (sb);
   if (r != 0)
     return r;
@@ -142,174 +260,323 @@ compare_default (const void *a, const void *b)
 }
 
 static int
-compare_name_sort (const void *a, const void *b)
+compare_value (const struct symbol *sa, const struct symbol *sb)
 {
-  int r = compare_name_search (a, b);
+  if (sa->value == sb->value)
+    return compare_default (sa, sb);
+  else if (sa->value < sb->value)
+    return -1;
+  else
+    return 1;
+}
 
-  if (r == 0)
-    return compare_default (a, b);
+void
+add_symbol (const char *name, word_t value, int flags)
+{
+  struct symbol_table *t = symbol_table ();
+  int i = t->num_symbols++;
+  size_t length = strlen (name);
+  int slot;
+
+  if (t->num_symbols > t->max_symbols)
+    t->symbols = grow (t->symbols, &t->max_symbols, sizeof *t->symbols, 1024);
+  if (2 * (t->hash_used + 1) > t->hash_size)
+    rehash (t);
+
+  /* Trailing spaces are stripped off the name. */
+  while (length > 0 && name[length - 1] == ' ')
+    length--;
+
+  t->symbols[i].value = value;
+  t->symbols[i].sequence = t->num_symbols;
+  t->symbols[i].flags = flags;
+  t->generation = new_generation ();
+  STATS_ADD (STATS_SYMBOLS, 1);
+
+  /* The name index holds the symbol which comes first when sorted by
+     name, and the name is only stored once. */
+  slot = find_name (t, name, length);
+  if (t->name_hash[slot] == -1)
+    {
+      t->symbols[i].name = intern (t, name, length);
+      t->name_hash[slot] = i;
+      t->hash_used++;
+    }
   else
-    return r;
+    {
+      t->symbols[i].name = t->symbols[t->name_hash[slot]].name;
+      if (compare_default (&t->symbols[i], &t->symbols[t->name_hash[slot]]) < 0)
+	t->name_hash[slot] = i;
+    }
 }
 
+/* The table being sorted, for compare_index. */
+static __thread struct symbol_table *sorting;
+
 static int
-compare_value_sort (const void *a, const void *b)
+compare_index (const void *a, const void *b)
 {
-  int r = compare_value_search (a, b);
-
-  if (r == 0)
-    return compare_default (a, b);
-  else
-    return r;
+  return compare_value (&sorting->symbols[*(const int *)a],
+			&sorting->symbols[*(const int *)b]);
 }
 
+/* Sort the symbols added since the last lookup by value, and merge
+   them into the value index. */
 static void
-sort_by (sort_mode_t wanted)
+update_value_index (struct symbol_table *t)
 {
-  if (sorted != wanted)
+  int old = t->num_by_value;
+  int *merged;
+  int i, j, k;
+
+  if (t->num_by_value == t->num_symbols)
+    return;
+
+  while (t->max_by_value < t->num_symbols)
+    t->by_value = grow (t->by_value, &t->max_by_value, sizeof *t->by_value, 1024);
+  for (i = old; i < t->num_symbols; i++)
+    t->by_value[i] = i;
+  sorting = t;
+  qsort (t->by_value + old, t->num_symbols - old, sizeof *t->by_value,
+	 compare_index);
+
+  if (old > 0)
     {
-      qsort (symbols, num_symbols, sizeof *symbols,
-	     wanted == SORT_NAME ? compare_name_sort : compare_value_sort);
-      sorted = wanted;
+      merged = malloc (t->num_symbols * sizeof *merged);
+      if (merged == NULL)
+	{
+	  fprintf (stderr, "Out of memory\n");
+	  exit (1);
+	}
+      for (i = 0, j = old, k = 0; k < t->num_symbols; k++)
+	if (j == t->num_symbols
+	    || (i < old && compare_index (&t->by_value[i], &t->by_value[j]) < 0))
+	  merged[k] = t->by_value[i++];
+	else
+	  merged[k] = t->by_value[j++];
+      memcpy (t->by_value, merged, t->num_symbols * sizeof *merged);
+      free (merged);
     }
+
+  t->num_by_value = t->num_symbols;
 }
 
-static const struct symbol *
-hint_accumulator (const struct symbol *first, word_t value)
+#define SYMBOL(i) (&t->symbols[t->by_value[i]])
+
+static int
+hint_accumulator (struct symbol_table *t, int first, word_t value)
 {
-  const struct symbol *symbol = first;
+  int i = first;
 
   /* Look for a single-letter symbol that matches. */
   do
     {
-      if (strlen (symbol->name) == 1)
-	return symbol;
-      symbol++;
+      if (strlen (SYMBOL (i)->name) == 1)
+	return i;
+      i++;
     }
-  while (symbol < symbols + num_symbols && symbol->value == value);
+  while (i < t->num_by_value && SYMBOL (i)->value == value);
 
   /* Failing that, try two-letter symbols. */
-  symbol = first;
+  i = first;
   do
     {
-      if (strlen (symbol->name) == 2)
-	return symbol;
-      symbol++;
+      if (strlen (SYMBOL (i)->name) == 2)
+	return i;
+      i++;
     }
-  while (symbol < symbols + num_symbols && symbol->value == value);
+  while (i < t->num_by_value && SYMBOL (i)->value == value);
 
   return first;
 }
 
-static const struct symbol *
-hint_address (const struct symbol *first, word_t value)
+static int
+hint_address (struct symbol_table *t, int first, word_t value)
 {
   if (value < 020)
-    return hint_accumulator (first, value);
+    return hint_accumulator (t, first, value);
 
   return first;
 }
 
-static const struct symbol *
-hint_offset (const struct symbol *first, word_t value)
+static int
+hint_offset (struct symbol_table *t, int first, word_t value)
 {
-  const struct symbol *symbol = first;
+  int i = first;
 
   /* Look for a symbol with more than one letter. */
   do
     {
-      if (strlen (symbol->name) > 1)
-	return symbol;
-      symbol++;
+      if (strlen (SYMBOL (i)->name) > 1)
+	return i;
+      i++;
     }
-  while (symbol < symbols + num_symbols && symbol->value == value);
+  while (i < t->num_by_value && SYMBOL (i)->value == value);
 
   return first;
 }
 
-static const struct symbol *
-hint_channel (const struct symbol *first, word_t value)
+static int
+hint_channel (struct symbol_table *t, int first, word_t value)
 {
-  const struct symbol *symbol = first;
+  int i = first;
+  const char *name;
 
   /* Look for a symbol containing CH. */
   do
     {
-      if (strstr (symbol->name, "ch"))
-	return symbol;
-      symbol++;
+      if (strstr (SYMBOL (i)->name, "ch"))
+	return i;
+      i++;
     }
-  while (symbol < symbols + num_symbols && symbol->value == value);
+  while (i < t->num_by_value && SYMBOL (i)->value == value);
 
   /* Second try, symbols that end with C. */
-  symbol = first;
+  i = first;
   do
     {
-      if (symbol->name[strlen (symbol->name) - 1] == 'c')
-	return symbol;
-      symbol++;
+      name = SYMBOL (i)->name;
+      if (name[strlen (name) - 1] == 'c')
+	return i;
+      i++;
     }
-  while (symbol < symbols + num_symbols && symbol->value == value);
+  while (i < t->num_by_value && SYMBOL (i)->value == value);
 
   return first;
 }
 
-const struct symbol *
-get_symbol_by_value (word_t value, int hint)
+static int
+resolve (struct symbol_table *t, word_t value, int hint)
 {
-  struct symbol key = { NULL, value, -1, 0 };
-  const struct symbol *first;
+  int low, high, middle, first;
 
-  if (symbols_mode == SYMBOLS_NONE || hint == HINT_NUMBER)
-    return NULL;
+  update_value_index (t);
 
-  sort_by (SORT_VALUE);
-  first = bsearch (&key, symbols, num_symbols, sizeof *symbols,
-		   compare_value_search);
+  /* Find the first symbol with the value. */
+  low = 0;
+  high = t->num_by_value;
+  while (low < high)
+    {
+      middle = (low + high) / 2;
+      if (SYMBOL (middle)->value < value)
+	low = middle + 1;
+      else
+	high = middle;
+    }
+  if (low == t->num_by_value || SYMBOL (low)->value != value)
+    return -1;
+  first = low;
 
-  if (first == NULL)
+  switch (hint)
+    {
+    case HINT_ACCUMULATOR: first = hint_accumulator (t, first, value); break;
+    case HINT_CHANNEL:     first = hint_channel (t, first, value); break;
+    case HINT_ADDRESS:     first = hint_address (t, first, value); break;
+    case HINT_OFFSET:      first = hint_offset (t, first, value); break;
+    case HINT_IMMEDIATE:   first = hint_offset (t, first, value); break;
+    }
+
+  if (dis10->symbols_mode == SYMBOLS_DDT)
+    {
+      if (SYMBOL (first)->flags & (SYMBOL_KILLED | SYMBOL_HALFKILLED))
+	return -1;
+    }
+
+  return t->by_value[first];
+}
+
+/* The symbol chosen for each value and hint is remembered in a small
+   table.  Entries from an older generation are free.  When all slots
+   a key may use are taken, the first one is reused.  Each thread has
+   its own table, so parallel disassembly needs no locking. */
+#define RESOLVED_SIZE	4096
+#define RESOLVED_PROBES	8
+
+struct resolved {
+  word_t value;
+  int generation;
+  int hint;
+  int symbol;
+};
+
+static __thread struct resolved resolved[RESOLVED_SIZE];
+
+const struct symbol *
+get_symbol_by_value (word_t value, int hint)
+{
+  struct symbol_table *t = dis10->symbols;
+  struct resolved *r, *free_slot = NULL;
+  unsigned h;
+  int i;
+
+  if (t == NULL || dis10->symbols_mode == SYMBOLS_NONE
+      || hint == HINT_NUMBER)
     return NULL;
 
-  /* Wind the pointer back to find the first symbol that matches. */
-  while (first > symbols && (first - 1)->value == value)
-    first--;
+  STATS_ADD (STATS_LOOKUPS, 1);
 
-  switch (hint)
+  h = (unsigned)(((unsigned long long)value * 0x9E3779B97F4A7C15ULL) >> 40)
+      + hint * 0x9E37U;
+  for (i = 0; i < RESOLVED_PROBES; i++)
     {
-    case HINT_ACCUMULATOR: first = hint_accumulator (first, value); break;
-    case HINT_CHANNEL:     first = hint_channel (first, value); break;
-    case HINT_ADDRESS:     first = hint_address (first, value); break;
-    case HINT_OFFSET:      first = hint_offset (first, value); break;
-    case HINT_IMMEDIATE:   first = hint_offset (first, value); break;
+      r = &resolved[(h + i) & (RESOLVED_SIZE - 1)];
+      if (r->generation != t->generation)
+	{
+	  if (free_slot == NULL)
+	    free_slot = r;
+	}
+      else if (r->value == value && r->hint == hint)
+	return r->symbol == -1 ? NULL : &t->symbols[r->symbol];
     }
 
-  if (symbols_mode == SYMBOLS_DDT)
+  r = free_slot ? free_slot : &resolved[h & (RESOLVED_SIZE - 1)];
+  r->value = value;
+  r->hint = hint;
+  STATS_ADD (STATS_RESOLVED, 1);
+  r->symbol = resolve (t, value, hint);
+  r->generation = t->generation;
+
+  return r->symbol == -1 ? NULL : &t->symbols[r->symbol];
+}
+
+/* This changes whenever a lookup by value may give another answer.
+   It is zero when there are no symbols. */
+int
+symbols_generation (void)
+{
+  return dis10->symbols != NULL ? dis10->symbols->generation : 0;
+}
+
+/* Return the number of symbols, and the symbols in the order they
+   were added. */
+int
+get_symbols (const struct symbol **symbols)
+{
+  struct symbol_table *t = dis10->symbols;
+
+  if (t == NULL)
     {
-      if (first != NULL && first->flags & (SYMBOL_KILLED | SYMBOL_HALFKILLED))
-	return NULL;
+      *symbols = NULL;
+      return 0;
     }
 
-  return first;
+  *symbols = t->symbols;
+  return t->num_symbols;
 }
 
 const struct symbol *
 get_symbol_by_name (const char *name)
 {
-  struct symbol key = { name, 0, -1, 0 };
-  const struct symbol *first;
-
-  sort_by (SORT_NAME);
-  first = bsearch (&key, symbols, num_symbols, sizeof *symbols,
-		   compare_name_search);
+  struct symbol_table *t = dis10->symbols;
+  int slot;
 
-  if (first == NULL)
+  if (t == NULL || t->hash_size == 0)
     return NULL;
 
-  /* Wind the pointer back to find the first symbol that matches. */
-  while (first > symbols && strcmp ((first - 1)->name, name) == 0)
-    first--;
-
-  return first;
+  slot = find_name (t, name, strlen (name));
+  if (t->name_hash[slot] == -1)
+    return NULL;
+  return &t->symbols[t->name_hash[slot]];
 }
 
 word_t
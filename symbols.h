@@ -49,6 +49,9 @@ struct symbol
 extern void add_symbol (const char *name, word_t value, int flags);
 extern const struct symbol *get_symbol_by_name (const char *name);
 extern const struct symbol *get_symbol_by_value (word_t value, int hint);
+extern int symbols_generation (void);
+extern int get_symbols (const struct symbol **symbols);
 extern word_t get_symbol_value (const char *name);
+extern void free_symbol_table (struct symbol_table *table);
 
 #endif
@@ -14,6 +14,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "dis.h"
 
@@ -76,7 +77,8 @@ static void write_reclen (FILE *f, int n)
 int get_9track_record (FILE *f, word_t **buffer)
 {
   int i, x, reclen;
-  word_t *p;
+  unsigned char *data;
+  size_t got;
 
   reclen = get_reclen (f);
   if (reclen == 0)
@@ -85,7 +87,7 @@ int get_9track_record (FILE *f, word_t **buffer)
     {
       fprintf (stderr, "Not a CORE DUMP tape image.\n"
 	       "reclen = %d\n", reclen);
-      exit (1);
+      dis10_fail ();
     }
   
   *buffer = malloc (sizeof (word_t) * (reclen/5));
@@ -95,8 +97,21 @@ int get_9track_record (FILE *f, word_t **buffer)
       exit (1);
     }
 
-  for (i = 0, p = *buffer; i < (reclen / 5); i++)
-    *p++ = get_core_word (f);
+  data = malloc (reclen);
+  if (data == NULL)
+    {
+      fprintf (stderr, "Out of memory.\n");
+      exit (1);
+    }
+
+  /* Like get_core_word, pad a short word with zeros, and return -1
+     for words after the end of file. */
+  got = fread (data, 1, reclen, f);
+  memset (data + got, 0, reclen - got);
+  unpack_core_words (data, *buffer, reclen / 5);
+  for (i = got / 5 + 1; i < reclen / 5; i++)
+    (*buffer)[i] = -1;
+  free (data);
 
   /* First try the E-11 tape format. */
   x = get_reclen (f);
@@ -110,7 +125,7 @@ int get_9track_record (FILE *f, word_t **buffer)
 	{
 	  fprintf (stderr, "Error in tape image format.\n"
 		   "%d != %d\n", reclen, x);
-	  exit (1);
+	  dis10_fail ();
 	}
     }
 
@@ -138,7 +153,7 @@ void write_7track_record (FILE *f, word_t *buffer, int n)
 
 void write_9track_record (FILE *f, word_t *buffer, int n)
 {
-  int i;
+  unsigned char *data;
 
   /* To write a tape record in the SIMH tape image format, first write
      a 32-bit record length, then data frames, then the length again.
@@ -153,8 +168,15 @@ void write_9track_record (FILE *f, word_t *buffer, int n)
   if (n == 0)
     return;
   
-  for (i = 0; i < n; i++)
-    write_core_word (f, *buffer++);
+  data = malloc (5 * n);
+  if (data == NULL)
+    {
+      fprintf (stderr, "Out of memory.\n");
+      exit (1);
+    }
+  pack_core_words (buffer, data, n);
+  fwrite (data, 1, 5 * n, f);
+  free (data);
 
   /* Pad out to make the record data an even number of octets. */
   if ((n * 5) & 1)
@@ -175,7 +197,7 @@ int get_7track_record (FILE *f, word_t **buffer)
     {
       fprintf (stderr, "Not a 7-track tape image.\n"
 	       "reclen = %d\n", reclen);
-      exit (1);
+      dis10_fail ();
     }
   
   *buffer = malloc (sizeof (word_t) * (reclen/6));
@@ -193,7 +215,7 @@ int get_7track_record (FILE *f, word_t **buffer)
     {
       fprintf (stderr, "Error in tape image format.\n"
 	       "%d != %d\n", reclen, x);
-      exit (1);
+      dis10_fail ();
     }
 
   if (reclen == 0)
@@ -204,55 +226,53 @@ int get_7track_record (FILE *f, word_t **buffer)
   return reclen / 6;
 }
 
-static word_t *buffer = NULL;
-int n, words;
-int end_of_file = 1;
-int end_of_tape = 0;
-
+/* Read a word from a tape image.  The record being read is kept in
+   the current context. */
 static word_t
 get_tape_word (FILE *f)
 {
+  struct word_stream *s = &dis10->input;
   word_t word;
 
-  if (end_of_tape)
+  if (s->end_of_tape)
     return -1;
 
-  if (buffer == NULL)
+  if (s->buffer == NULL)
     {
       if (input_word_format == &tape_word_format)
-	words = get_9track_record (f, &buffer);
+	s->words = get_9track_record (f, &s->buffer);
       else
-	words = get_7track_record (f, &buffer);
-      if (words == 0)
+	s->words = get_7track_record (f, &s->buffer);
+      if (s->words == 0)
 	{
-	  end_of_file = 1;
+	  s->end_of_file = 1;
 	  if (input_word_format == &tape_word_format)
-	    words = get_9track_record (f, &buffer);
+	    s->words = get_9track_record (f, &s->buffer);
 	  else
-	    words = get_7track_record (f, &buffer);
-	  if (words == 0)
+	    s->words = get_7track_record (f, &s->buffer);
+	  if (s->words == 0)
 	    {
-	      end_of_tape = 1;
+	      s->end_of_tape = 1;
 	      return -1;
 	    }
 	}
-      n = 0;
+      s->n = 0;
     }
 
-  word = buffer[n++];
+  word = s->buffer[s->n++];
 
-  if (end_of_file)
+  if (s->end_of_file)
     {
       word |= START_FILE;
-      end_of_file = 0;
+      s->end_of_file = 0;
     }
-  else if (n == 1)
+  else if (s->n == 1)
     word |= START_RECORD;
 
-  if (n == words)
+  if (s->n == s->words)
     {
-      free (buffer);
-      buffer = NULL;
+      free (s->buffer);
+      s->buffer = NULL;
     }
 
   return word;
@@ -261,11 +281,13 @@ get_tape_word (FILE *f)
 static void
 rewind_tape_word (FILE *f)
 {
-  if (buffer != NULL)
-    free (buffer);
-  end_of_file = 1;
-  end_of_tape = 0;
-  buffer = NULL;
+  struct word_stream *s = &dis10->input;
+
+  if (s->buffer != NULL)
+    free (s->buffer);
+  s->end_of_file = 1;
+  s->end_of_tape = 0;
+  s->buffer = NULL;
   rewind (f);
 }
 
@@ -274,6 +296,8 @@ struct word_format tape_word_format = {
   get_tape_word,
   rewind_tape_word,
   NULL,
+  NULL,
+  NULL,
   NULL
 };
 
@@ -282,5 +306,7 @@ struct word_format tape7_word_format = {
   get_tape_word,
   rewind_tape_word,
   NULL,
+  NULL,
+  NULL,
   NULL
 };
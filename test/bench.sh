@@ -0,0 +1,77 @@
+#!/bin/sh
+# Time dis10 and the utilities on synthetic images made by mkimage, and
+# print the throughput.  The first argument is the number of words in
+# each image; formats with 18-bit addresses are capped below that.
+
+set -e
+
+WORDS=${1:-4194304}
+DIR=out/bench
+JOBS=$(nproc 2>/dev/null || echo 4)
+
+rm -rf $DIR
+mkdir -p $DIR
+
+now () {
+    date +%s.%N
+}
+
+# run <name> <image> <words> <command...>
+run () {
+    name=$1 image=$2 words=$3
+    shift 3
+    start=$(now)
+    "$@" > $DIR/run.out 2>&1 || {
+	echo "$name: failed"
+	cat $DIR/run.out
+	exit 1
+    }
+    end=$(now)
+    bytes=$(wc -c < $image)
+    awk -v name="$name" -v w="$words" -v b="$bytes" -v s="$start" -v e="$end" \
+	'BEGIN { t = e - s; if (t <= 0) t = 1e-6;
+		 printf "%-28s %8.3f s %12.0f words/s %9.2f MB/s\n",
+			name, t, w / t, b / t / 1e6 }'
+}
+
+image () {
+    ./test/mkimage "$@"
+}
+
+echo "Images of $WORDS words, $JOBS jobs."
+echo
+
+for w in its core bin dta x pt data8 tape tape7; do
+    image -W$w -Fraw -n$WORDS $DIR/raw.$w
+    run "conv36 -W$w" $DIR/raw.$w $WORDS \
+	./conv36 -W$w -Xits $DIR/raw.$w
+    run "dis10 -r -W$w" $DIR/raw.$w $WORDS \
+	./dis10 -r -W$w $DIR/raw.$w
+done
+
+run "dis10 -r -Wits -j$JOBS" $DIR/raw.its $WORDS \
+    ./dis10 -r -Wits -j$JOBS $DIR/raw.its
+
+for f in sblk pdump shr dmp; do
+    image -Wits -F$f -n$WORDS $DIR/image.$f
+    n=$WORDS
+    case $f in sblk|pdump|shr) [ $n -gt 229375 ] && n=229375;; esac
+    run "dis10 -F$f -Sall" $DIR/image.$f $n \
+	./dis10 -F$f -Sall $DIR/image.$f
+done
+
+image -Wits -Farc -n$WORDS $DIR/image.arc
+mkdir -p $DIR/arc
+run "itsarc -x" $DIR/image.arc 229375 \
+    sh -c "cd $DIR/arc && ../../../itsarc -x ../image.arc"
+
+image -Wtape -Ftito -n$WORDS $DIR/image.tito
+mkdir -p $DIR/tito
+run "tito -x" $DIR/image.tito $WORDS \
+    sh -c "cd $DIR/tito && ../../../tito -x -f ../image.tito"
+
+run "scrmbl" $DIR/raw.its $WORDS \
+    ./scrmbl -Wits -Xits bench $DIR/raw.its $DIR/raw.scrmbl
+run "scrmbl -d" $DIR/raw.scrmbl $WORDS \
+    ./scrmbl -d -Wits -Xits bench $DIR/raw.scrmbl $DIR/raw.unscrm
+cmp $DIR/raw.its $DIR/raw.unscrm
@@ -0,0 +1,86 @@
+/* Measure the throughput of the bulk word conversion functions, for
+   each vectorization level the CPU supports.  Throughput is in octets
+   of packed data per second; a bin word is four and a half octets. */
+
+#include <string.h>
+#include <time.h>
+
+#include "dis.h"
+
+#define WORDS (4 * 1024 * 1024)
+#define ROUNDS 10
+
+static const char *level_name[] = { "scalar", "ssse3", "avx2" };
+
+static double
+now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+report (const char *format, const char *what, int level, double octets,
+	double seconds)
+{
+  double bytes = (double)WORDS * octets * ROUNDS;
+  printf ("%-5s %-7s %-7s %7.2f GB/s\n", format, what, level_name[level],
+	  bytes / seconds / 1e9);
+}
+
+int main (void)
+{
+  unsigned char *data = malloc (9 * WORDS);
+  word_t *words = malloc (sizeof (word_t) * WORDS);
+  int level, i;
+  double t;
+
+  if (data == NULL || words == NULL)
+    {
+      fprintf (stderr, "Out of memory\n");
+      return 1;
+    }
+
+  srand (1);
+  for (i = 0; i < 9 * WORDS; i++)
+    data[i] = rand ();
+
+  for (level = BULK_SCALAR; level <= BULK_AVX2; level++)
+    {
+      if (bulk_select (level) != level)
+	break;
+
+      t = now ();
+      for (i = 0; i < ROUNDS; i++)
+	unpack_core_words (data, words, WORDS);
+      report ("core", "unpack", level, 5, now () - t);
+
+      t = now ();
+      for (i = 0; i < ROUNDS; i++)
+	pack_core_words (words, data, WORDS);
+      report ("core", "pack", level, 5, now () - t);
+
+      t = now ();
+      for (i = 0; i < ROUNDS; i++)
+	unpack_dta_words (data, words, WORDS);
+      report ("dta", "unpack", level, 8, now () - t);
+
+      t = now ();
+      for (i = 0; i < ROUNDS; i++)
+	pack_dta_words (words, data, WORDS);
+      report ("dta", "pack", level, 8, now () - t);
+
+      t = now ();
+      for (i = 0; i < ROUNDS; i++)
+	unpack_bin_words (data, words, WORDS / 2);
+      report ("bin", "unpack", level, 4.5, now () - t);
+
+      t = now ();
+      for (i = 0; i < ROUNDS; i++)
+	pack_bin_words (words, data, WORDS / 2);
+      report ("bin", "pack", level, 4.5, now () - t);
+    }
+
+  return 0;
+}
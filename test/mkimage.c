@@ -0,0 +1,474 @@
+/* Write a synthetic image for benchmarks.  The contents only depend
+   on the options, so the same image can be made again anywhere.  Most
+   words look like instructions referring to addresses in the image,
+   and every sixteenth address has a symbol. */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "dis.h"
+
+#define JRST(a)		(0254000000000LL | (a))
+#define HEADER(n, x)	(((-(word_t)(n) << 18) | (x)) & WORDMASK)
+#define SYLCL		0100000000000LL
+#define PAGE_RW		0000000600000LL
+#define NEW_ARC		0416243210101LL
+#define FAILS		0124641515463LL
+#define AFE		0414645LL
+
+/* 1985-07-09 12:00:00 as an ITS date and time. */
+#define DATIME		(((word_t)((85 << 9) | (7 << 5) | 9) << 18) | 86400)
+
+#define ARC_FILES	200
+#define TITO_FILES	16
+#define TITO_RECORD	2048
+#define DMP_SYMBOLS	8192	/* Below the old limit of dis10. */
+
+static FILE *output;
+static int tape;
+static word_t *record;
+static int record_words;
+
+static word_t state;
+
+static word_t
+random_word (void)
+{
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state & WORDMASK;
+}
+
+static word_t
+image_word (int n)
+{
+  word_t word = random_word ();
+
+  /* A quarter of the words are data. */
+  if ((word & 3) == 0)
+    return word;
+
+  /* Instructions from MOVE to TRZE, with an address in the image. */
+  return ((0200 + (word >> 2) % 0500) << 27)
+	 | (word & 0000777000000LL)
+	 | ((word >> 5) % n);
+}
+
+static void
+emit (word_t word)
+{
+  if (!tape)
+    {
+      write_word (output, word);
+      return;
+    }
+
+  if (record_words == TITO_RECORD)
+    {
+      fprintf (stderr, "Tape record too long\n");
+      exit (1);
+    }
+  record[record_words++] = word;
+}
+
+static void
+write_record (word_t *buffer, int n)
+{
+  if (tape == 9)
+    write_9track_record (output, buffer, n);
+  else
+    write_7track_record (output, buffer, n);
+}
+
+static void
+end_record (void)
+{
+  if (record_words > 0)
+    write_record (record, record_words);
+  record_words = 0;
+}
+
+static void
+tape_mark (void)
+{
+  end_record ();
+  write_record (record, 0);
+}
+
+static word_t
+squoze (const char *name)
+{
+  word_t word = 0;
+  int i, c;
+
+  for (i = 0; i < 6; i++)
+    {
+      c = *name ? *name++ : ' ';
+      if (c >= '0' && c <= '9')
+	c = c - '0' + 1;
+      else if (c >= 'a' && c <= 'z')
+	c = c - 'a' + 11;
+      else
+	c = 0;
+      word = 40 * word + c;
+    }
+
+  return word;
+}
+
+/* Emit count words of an image with n words. */
+static void
+emit_image (int count, int n)
+{
+  int i;
+
+  for (i = 0; i < count; i++)
+    emit (image_word (n));
+}
+
+/* Start instruction, symbol table, and duplicate start instruction,
+   as in SBLK files. */
+static void
+emit_symbols (int n)
+{
+  word_t checksum, word;
+  char name[7];
+  int i, j, symbols, block;
+
+  emit (JRST (0100));
+
+  symbols = n / 16;
+  for (i = 0; i < symbols; i += block)
+    {
+      block = symbols - i < 010000 ? symbols - i : 010000;
+      checksum = HEADER (2 * block, 0);
+      emit (checksum);
+      for (j = i; j < i + block; j++)
+	{
+	  sprintf (name, "s%o", j);
+	  word = squoze (name) | SYLCL;
+	  checksum = (checksum << 1) + (checksum >> 35) + word;
+	  checksum &= WORDMASK;
+	  checksum = (checksum << 1) + (checksum >> 35) + 16 * j;
+	  checksum &= WORDMASK;
+	  emit (word);
+	  emit (16 * j);
+	}
+      emit (checksum);
+    }
+
+  emit (JRST (0100));
+}
+
+static void
+write_sblk (int n)
+{
+  word_t checksum, word;
+  int address, block, i;
+
+  emit (0);
+  emit (JRST_1);
+
+  for (address = 0; address < n; address += block)
+    {
+      block = n - address < 0400 ? n - address : 0400;
+      checksum = HEADER (block, address);
+      emit (checksum);
+      for (i = 0; i < block; i++)
+	{
+	  word = image_word (n);
+	  checksum = (checksum << 1) + (checksum >> 35) + word;
+	  checksum &= WORDMASK;
+	  emit (word);
+	}
+      emit (checksum);
+    }
+
+  emit_symbols (n);
+}
+
+static void
+write_pdump (int n)
+{
+  int pages = (n + ITS_PAGESIZE - 1) / ITS_PAGESIZE;
+  int i;
+
+  emit (0);
+  for (i = 0; i < 256; i++)
+    emit (i < pages ? PAGE_RW : 0);
+  for (i = 257; i < ITS_PAGESIZE; i++)
+    emit (0);
+
+  emit_image (pages * ITS_PAGESIZE, n);
+  emit_symbols (n);
+}
+
+/* A DMP file starts at the job data area in 074.  .JBSA starts the
+   program at 0140, and .JBSYM points to a symbol table at the top of
+   the first 256K words. */
+static void
+write_dmp (int n)
+{
+  int address, end, table, symbols, i;
+  char name[7];
+  word_t word;
+
+  end = 074 + n < 01000000 ? 074 + n : 01000000;
+  symbols = n / 16 < DMP_SYMBOLS ? n / 16 : DMP_SYMBOLS;
+  table = end - 2 * symbols;
+  if (table < 0140)
+    symbols = 0;
+
+  for (address = 074; address < 074 + n; address++)
+    {
+      if (address == 0116 && symbols > 0)
+	word = HEADER (2 * symbols, table);
+      else if (address == 0120)
+	word = ((word_t)end << 18 | 0140) & WORDMASK;
+      else if (address == 0121)
+	word = end & 0777777;
+      else if (address < 0140)
+	word = 0;
+      else if (symbols > 0 && address >= table && address < end)
+	{
+	  i = (address - table) / 2;
+	  sprintf (name, "s%o", i);
+	  word = (address - table) % 2 ? 16 * i : squoze (name) | SYLCL;
+	}
+      else
+	word = image_word (n);
+      emit (word);
+    }
+}
+
+static void
+write_shr (int n)
+{
+  int pages = (n + DEC_PAGESIZE - 1) / DEC_PAGESIZE;
+  int i;
+
+  /* One directory entry maps all pages, from file page 1. */
+  emit (01776000003LL);
+  emit (0240000000001LL);
+  emit ((word_t)(pages - 1) << 27);
+  emit (01777000001LL);
+  for (i = 4; i < DEC_PAGESIZE; i++)
+    emit (0);
+
+  emit_image (pages * DEC_PAGESIZE, n);
+}
+
+static void
+write_arc (int n)
+{
+  word_t dir[02000];
+  int files = ARC_FILES;
+  int length = n / files;
+  int name_beg = 02000 - 5 * files;
+  word_t data = 02000;
+  char name[7];
+  int i, slot;
+
+  memset (dir, 0, sizeof dir);
+  dir[0] = NEW_ARC;
+  dir[1] = name_beg;
+  dir[2] = 02000 + files * (length + 3);
+  dir[3] = DATIME;
+  dir[4] = DATIME;
+  for (i = 0; i < files; i++)
+    {
+      slot = name_beg + 5 * i;
+      sprintf (name, "F%d", i);
+      dir[slot] = ascii_to_sixbit ("BENCH");
+      dir[slot + 1] = ascii_to_sixbit (name);
+      dir[slot + 2] = data;
+      dir[slot + 3] = DATIME;
+      dir[slot + 4] = DATIME & 0777777000000LL;
+      data += length + 3;
+    }
+
+  for (i = 0; i < 02000; i++)
+    emit (dir[i]);
+  for (i = 0; i < files; i++)
+    {
+      emit (length + 3);
+      emit (0);
+      emit (0);
+      emit_image (length, n);
+    }
+}
+
+static void
+tito_header (void)
+{
+  emit (016000005LL);
+  emit (FAILS);
+  emit ((AFE << 18) | 1);
+  emit (0);
+  emit (01000002LL);
+  end_record ();
+}
+
+static void
+write_tito (int n)
+{
+  int length = n / TITO_FILES;
+  char name[7];
+  int i, j, k;
+
+  tito_header ();
+  tape_mark ();
+
+  for (i = 0; i < TITO_FILES; i++)
+    {
+      /* File header record, without data. */
+      emit (0777777000100LL);
+      for (j = 1; j < 0101; j++)
+	{
+	  sprintf (name, "F%d", i);
+	  switch (j)
+	    {
+	    case 1:    emit ((0446353LL << 18) | 14); break;
+	    case 3:    emit (01000002LL); break;
+	    case 4:    emit (ascii_to_sixbit (name)); break;
+	    case 5:    emit (ascii_to_sixbit ("DAT") & 0777777000000LL); break;
+	    case 071:  emit (ascii_to_sixbit ("BENCH")); break;
+	    case 072:  emit (ascii_to_sixbit ("")); break;
+	    case 075:  emit ((6250LL << 18) | 9); break;
+	    case 0100: emit ((1LL << 18) | (i + 1)); break;
+	    default:   emit (0); break;
+	    }
+	}
+      end_record ();
+
+      for (j = 0; j < length; j += k)
+	{
+	  k = length - j < TITO_RECORD - 1 ? length - j : TITO_RECORD - 1;
+	  emit (k);
+	  emit_image (k, n);
+	  end_record ();
+	}
+    }
+
+  tito_header ();
+  tape_mark ();
+  tape_mark ();
+}
+
+static void
+usage (const char *argv0)
+{
+  fprintf (stderr, "Usage: %s [-W<word format>] [-F<format>] [-n<words>] "
+	   "[-s<seed>] <output file>\n\n", argv0);
+  fprintf (stderr, "Valid formats are: sblk pdump shr dmp raw arc tito\n");
+  usage_word_format ();
+  exit (1);
+}
+
+int
+main (int argc, char **argv)
+{
+  const char *format = "raw";
+  int n = 1024 * 1024;
+  int opt;
+
+  output_word_format = &its_word_format;
+  state = 1;
+
+  while ((opt = getopt (argc, argv, "W:F:n:s:")) != -1)
+    {
+      switch (opt)
+	{
+	case 'W':
+	  if (strcmp (optarg, "tape") == 0)
+	    tape = 9;
+	  else if (strcmp (optarg, "tape7") == 0)
+	    tape = 7;
+	  else if (parse_output_word_format (optarg))
+	    usage (argv[0]);
+	  break;
+	case 'F':
+	  format = optarg;
+	  break;
+	case 'n':
+	  n = strtol (optarg, NULL, 0);
+	  break;
+	case 's':
+	  state = strtoull (optarg, NULL, 0) | 1;
+	  break;
+	default:
+	  usage (argv[0]);
+	}
+    }
+
+  if (optind != argc - 1 || n < 1)
+    usage (argv[0]);
+
+  /* These formats only have 18-bit addresses. */
+  if (strcmp (format, "sblk") == 0 || strcmp (format, "pdump") == 0
+      || strcmp (format, "shr") == 0 || strcmp (format, "arc") == 0)
+    {
+      if (n > 0777777 - 0100000)
+	n = 0777777 - 0100000;
+    }
+  if (strcmp (format, "tito") == 0 && !tape)
+    {
+      fprintf (stderr, "The tito format is only for tape images.\n");
+      exit (1);
+    }
+
+  output = fopen (argv[optind], "wb");
+  if (output == NULL)
+    {
+      fprintf (stderr, "Error opening %s\n", argv[optind]);
+      exit (1);
+    }
+  if (tape)
+    {
+      record = malloc (TITO_RECORD * sizeof *record);
+      if (record == NULL)
+	{
+	  fprintf (stderr, "Out of memory\n");
+	  exit (1);
+	}
+    }
+
+  if (strcmp (format, "sblk") == 0)
+    write_sblk (n);
+  else if (strcmp (format, "pdump") == 0)
+    write_pdump (n);
+  else if (strcmp (format, "shr") == 0)
+    write_shr (n);
+  else if (strcmp (format, "arc") == 0)
+    write_arc (n);
+  else if (strcmp (format, "tito") == 0)
+    write_tito (n);
+  else if (strcmp (format, "dmp") == 0 && !tape)
+    write_dmp (n);
+  else if (strcmp (format, "raw") == 0 || strcmp (format, "dmp") == 0)
+    {
+      if (tape)
+	{
+	  /* Records of a whole number of words, ending with a tape
+	     mark. */
+	  int i, k;
+	  for (i = 0; i < n; i += k)
+	    {
+	      k = n - i < TITO_RECORD ? n - i : TITO_RECORD;
+	      emit_image (k, n);
+	      end_record ();
+	    }
+	  tape_mark ();
+	}
+      else
+	emit_image (n, n);
+    }
+  else
+    usage (argv[0]);
+
+  if (!tape)
+    flush_word (output);
+  fclose (output);
+  return 0;
+}
@@ -23,6 +23,7 @@
 #include <sys/time.h>
 #include <sys/types.h>
 #include "dis.h"
+#include "stats.h"
 
 #define FAILS  0124641515463LL
 #define AFE    0414645LL
@@ -476,7 +477,7 @@ process_saveset (FILE *f)
 static void
 usage (const char *x)
 {
-  fprintf (stderr, "Usage: %s -t|-x [-v] [-7] [-Wformat] [-f file]\n", x);
+  fprintf (stderr, "Usage: %s -t|-x [-v] [-7] [-Wformat] [-f file] [--stats[=json]]\n", x);
   usage_word_format ();
   exit (1);
 }
@@ -490,7 +491,7 @@ main (int argc, char **argv)
   input_word_format = &tape_word_format;
   output_word_format = &aa_word_format;
 
-  if (argc == 1)
+  if (argc == 1 || parse_stats_option (&argc, argv))
     usage (argv[0]);
 
   while ((opt = getopt (argc, argv, "tvx7f:W:")) != -1)
@@ -541,6 +542,7 @@ main (int argc, char **argv)
   else if (verbose == 1)
     info = fopen ("/dev/null", "w");
 
+  stats_phase ("read");
   for (;;)
     process_saveset (f);
 
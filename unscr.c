@@ -15,21 +15,50 @@
 
 /* The unscr program takes a single argument, which is a file name.
    It will proceed to unscramble the contents with all possible
-   passwords.  If the result is printable ASCII text, it's printed to
-   stdout. */
+   passwords, or those in the range given by -s and -e.  If the result
+   is printable ASCII text, it's printed to stdout.
 
-#include <time.h>
+   The search is divided into chunks of keys.  Each thread takes the
+   next chunk when it's done with the previous one, so a slow thread
+   doesn't hold up the others.  All keys below the lowest chunk still
+   in progress have been tried; that key is saved to the checkpoint
+   file given by -c, and the search resumes from there if the file
+   exists. */
+
+#include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "dis.h"
 
+#define LAST_KEY	0777777777777LL
+#define CHUNK_KEYS	(1LL << 20)
+#define BENCHMARK_KEYS	(1LL << 22)
+#define BATCH_KEYS	1024
+
+/* Seconds between progress reports and checkpoints. */
+#define PROGRESS_INTERVAL	10
+#define CHECKPOINT_INTERVAL	60
+
 /* Just allocate a few words to hold the start of the file. */
 static word_t buffer[100];
+static int words;
+
+/* The search state is protected by the lock. */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static word_t next_key, end_key;
+static word_t keys_done;
+static word_t *working;
+static int jobs;
+static int finished;
 
 static void usage (const char *x)
 {
-  fprintf (stderr, "Usage: %s <file>\n", x);
+  fprintf (stderr, "Usage: %s [-b] [-j<threads>] [-s<first key>] [-e<last key>] [-c<checkpoint file>] <file>\n", x);
+  fprintf (stderr, "Keys are in octal.  -b measures keys per second on one thread.\n");
   exit (1);
 }
 
@@ -66,66 +95,267 @@ bad (int ch)
   return 0;
 }
 
+/* Check whether a word looks like ASCII text. */
 static int
-accepted (word_t *output, int n)
+accepted (word_t word)
 {
-  int i;
-  for (i = 0; i < n; i++)
-    {
-      if (output[i] & 1)
-	return 0;
-      if (bad ((output[i] >> 29) & 0177))
-	return 0;
-      if (bad ((output[i] >> 22) & 0177))
-	return 0;
-      if (bad ((output[i] >> 15) & 0177))
-	return 0;
-      if (bad ((output[i] >>  8) & 0177))
-	return 0;
-      if (bad ((output[i] >>  1) & 0177))
-	return 0;
-    }
+  if (word & 1)
+    return 0;
+  if (bad ((word >> 29) & 0177))
+    return 0;
+  if (bad ((word >> 22) & 0177))
+    return 0;
+  if (bad ((word >> 15) & 0177))
+    return 0;
+  if (bad ((word >>  8) & 0177))
+    return 0;
+  if (bad ((word >>  1) & 0177))
+    return 0;
   return 1;
 } 
 
+/* Unscramble the words one at a time, and give up as soon as one of
+   them doesn't look like text.  Most keys are rejected by the first
+   word. */
 static void
 decrypt (word_t key, int n)
 {
-  static word_t output[100];
+  struct scramble_key schedule;
+  word_t output[100];
+  word_t seed;
   int i;
 
-  scramble (1, 0, key, buffer, output, n);
+  scramble_schedule (&schedule, 1, key);
+  seed = schedule.seed;
+  for (i = 0; i < n; i++)
+    {
+      output[i] = scramble_word (&schedule, &seed, buffer[i]);
+      if (!accepted (output[i]))
+	return;
+    }
 
-  if (accepted(output, n))
+  flockfile (stdout);
+  printf ("\nKEY: ");
+  type6 (key);
+  putchar ('\n');
+  for (i = 0; i < n; i++)
+    type7 (output[i]);
+  fflush (stdout);
+  funlockfile (stdout);
+}
+
+/* Unscramble the first two words with a batch of keys at a time,
+   which rejects most of them.  The rest go through decrypt. */
+static void
+try_keys (word_t start, word_t end)
+{
+  word_t first[BATCH_KEYS], second[BATCH_KEYS];
+  word_t key;
+  int i, n;
+
+  for (key = start; key <= end; key += n)
     {
-      printf ("\nKEY: ");
-      type6 (key);
-      putchar ('\n');
+      n = end - key + 1 < BATCH_KEYS ? end - key + 1 : BATCH_KEYS;
+      if (words < 2)
+	{
+	  for (i = 0; i < n; i++)
+	    decrypt (key + i, words);
+	  continue;
+	}
+
+      scramble_keys (1, key, n, 0, buffer[0], first);
+      scramble_keys (1, key, n, 1, buffer[1], second);
       for (i = 0; i < n; i++)
-	type7 (output[i]);
+	if (accepted (first[i]) && accepted (second[i]))
+	  decrypt (key + i, words);
+    }
+}
+
+static void
+benchmark (word_t start)
+{
+  struct timespec t0, t1;
+  double seconds;
+
+  if (start > LAST_KEY - BENCHMARK_KEYS + 1)
+    start = LAST_KEY - BENCHMARK_KEYS + 1;
+
+  clock_gettime (CLOCK_MONOTONIC, &t0);
+  try_keys (start, start + BENCHMARK_KEYS - 1);
+  clock_gettime (CLOCK_MONOTONIC, &t1);
+
+  seconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+  fprintf (stderr, "%lld keys in %.2f seconds, %.0f keys/s per thread\n",
+	   BENCHMARK_KEYS, seconds, BENCHMARK_KEYS / seconds);
+}
+
+static int
+next_chunk (int thread, word_t *start, word_t *end)
+{
+  int more = 0;
+
+  pthread_mutex_lock (&lock);
+  working[thread] = -1;
+  if (next_key <= end_key)
+    {
+      *start = next_key;
+      *end = next_key + CHUNK_KEYS - 1;
+      if (*end > end_key)
+	*end = end_key;
+      next_key = *end + 1;
+      working[thread] = *start;
+      more = 1;
     }
+  pthread_mutex_unlock (&lock);
+
+  return more;
+}
+
+static void *
+search (void *arg)
+{
+  int thread = (int)(long)arg;
+  word_t start, end;
+
+  while (next_chunk (thread, &start, &end))
+    {
+      try_keys (start, end);
+
+      pthread_mutex_lock (&lock);
+      keys_done += end - start + 1;
+      pthread_mutex_unlock (&lock);
+    }
+
+  pthread_mutex_lock (&lock);
+  finished++;
+  pthread_mutex_unlock (&lock);
+
+  return NULL;
+}
+
+/* Return the lowest key which may not have been tried yet.  Must be
+   called with the lock held. */
+static word_t
+lowest_key (void)
+{
+  word_t key = next_key;
+  int i;
+
+  for (i = 0; i < jobs; i++)
+    if (working[i] != -1 && working[i] < key)
+      key = working[i];
+
+  return key;
+}
+
+static void
+write_checkpoint (const char *name, word_t key)
+{
+  char tmp[1024];
+  FILE *f;
+
+  snprintf (tmp, sizeof tmp, "%s.tmp", name);
+  f = fopen (tmp, "w");
+  if (f == NULL)
+    {
+      fprintf (stderr, "Error writing %s: %s\n", tmp, strerror (errno));
+      return;
+    }
+  fprintf (f, "%012llo\n", key);
+  fclose (f);
+  if (rename (tmp, name) != 0)
+    fprintf (stderr, "Error writing %s: %s\n", name, strerror (errno));
+}
+
+static word_t
+read_checkpoint (const char *name, word_t key)
+{
+  word_t saved;
+  FILE *f;
+
+  f = fopen (name, "r");
+  if (f == NULL)
+    return key;
+  if (fscanf (f, "%llo", &saved) == 1 && saved > key)
+    {
+      fprintf (stderr, "Resuming from key %012llo.\n", saved);
+      key = saved;
+    }
+  fclose (f);
+
+  return key;
+}
+
+static void
+progress (word_t done, word_t total, time_t elapsed)
+{
+  double rate = elapsed > 0 ? (double)done / elapsed : 0;
+  long eta = rate > 0 ? (long)((total - done) / rate) : 0;
+
+  fprintf (stderr, "%llo/%llo keys (%.1f%%), %.0f keys/s, ETA %ld:%02ld:%02ld\n",
+	   done, total, total > 0 ? 100.0 * done / total : 100.0, rate,
+	   eta / 3600, (eta / 60) % 60, eta % 60);
 }
 
 int
 main (int argc, char **argv)
 {
-  word_t word;
+  const char *checkpoint = NULL;
+  word_t word, start_key, total, done, low;
+  pthread_t *thread;
+  time_t t0, now, last_checkpoint, last_progress;
   word_t *p;
-  word_t key = 0;
   FILE *f;
-  int i, n;
+  int i, opt, running;
+  int bench = 0;
 
   input_word_format = &its_word_format;
 
-  if (argc != 2)
+  jobs = sysconf (_SC_NPROCESSORS_ONLN);
+  start_key = 0;
+  end_key = LAST_KEY;
+
+  while ((opt = getopt (argc, argv, "bj:s:e:c:")) != -1)
+    {
+      switch (opt)
+	{
+	case 'b':
+	  bench = 1;
+	  break;
+	case 'j':
+	  jobs = atoi (optarg);
+	  break;
+	case 's':
+	  start_key = strtoll (optarg, NULL, 8) & LAST_KEY;
+	  break;
+	case 'e':
+	  end_key = strtoll (optarg, NULL, 8) & LAST_KEY;
+	  break;
+	case 'c':
+	  checkpoint = optarg;
+	  break;
+	default:
+	  usage (argv[0]);
+	}
+    }
+
+  if (optind != argc - 1)
     usage (argv[0]);
+  if (jobs < 1)
+    jobs = 1;
 
-  f = fopen (argv[1], "rb");
+  f = fopen (argv[optind], "rb");
+  if (f == NULL)
+    {
+      fprintf (stderr, "%s: Error opening %s: %s\n",
+	       argv[0], argv[optind], strerror (errno));
+      return 1;
+    }
 
   /* Only unscramble this many words. */
-  n = 30;
+  words = 30;
 
-  for (p = buffer, i = 0; i < n; i++)
+  for (p = buffer, i = 0; i < words; i++)
     {
       if ((word = get_word (f)) == -1)
 	break;
@@ -133,15 +363,74 @@ main (int argc, char **argv)
     }
   fclose (f);
 
-  for (key = 0; key <= 0777777777777LL; key++)
+  /* Pick the kernel before any threads use it. */
+  scramble_select (BULK_AVX512);
+
+  if (bench)
+    {
+      benchmark (start_key);
+      return 0;
+    }
+
+  total = end_key >= start_key ? end_key - start_key + 1 : 0;
+  if (checkpoint != NULL)
+    start_key = read_checkpoint (checkpoint, start_key);
+  next_key = start_key;
+  keys_done = total - (end_key >= start_key ? end_key - start_key + 1 : 0);
+
+  working = malloc (jobs * sizeof *working);
+  thread = malloc (jobs * sizeof *thread);
+  if (working == NULL || thread == NULL)
+    {
+      fprintf (stderr, "Out of memory.\n");
+      exit (1);
+    }
+  for (i = 0; i < jobs; i++)
+    working[i] = -1;
+
+  for (i = 0; i < jobs; i++)
+    {
+      if (pthread_create (&thread[i], NULL, search, (void *)(long)i) != 0)
+	{
+	  fprintf (stderr, "Error creating thread.\n");
+	  exit (1);
+	}
+    }
+
+  t0 = last_checkpoint = last_progress = time (NULL);
+  done = keys_done;
+  for (;;)
     {
-      if ((key & 077777777) == 0)
+      sleep (1);
+      now = time (NULL);
+
+      pthread_mutex_lock (&lock);
+      running = jobs - finished;
+      low = lowest_key ();
+      word = keys_done;
+      pthread_mutex_unlock (&lock);
+
+      if (running == 0)
+	break;
+
+      if (now - last_progress >= PROGRESS_INTERVAL)
+	{
+	  progress (word - done, total - done, now - t0);
+	  last_progress = now;
+	}
+
+      if (checkpoint != NULL && now - last_checkpoint >= CHECKPOINT_INTERVAL)
 	{
-	  putchar ('.');
-	  fflush (stdout);
+	  write_checkpoint (checkpoint, low);
+	  last_checkpoint = now;
 	}
-      decrypt (key, n);
     }
 
+  for (i = 0; i < jobs; i++)
+    pthread_join (thread[i], NULL);
+
+  if (checkpoint != NULL)
+    write_checkpoint (checkpoint, low);
+
   return 0;
 }
@@ -17,9 +17,31 @@
 #include <string.h>
 
 #include "dis.h"
+#include "stats.h"
 
-struct word_format *input_word_format = &its_word_format;
-struct word_format *output_word_format = &its_word_format;
+static struct dis10_context default_context = DIS10_CONTEXT_INIT;
+
+__thread struct dis10_context *dis10 = &default_context;
+
+/* Make a context current for this thread, and return the previous
+   one. */
+struct dis10_context *
+dis10_use (struct dis10_context *context)
+{
+  struct dis10_context *previous = dis10;
+  dis10 = context;
+  return previous;
+}
+
+/* Give up on the input after reporting an error in it.  If the
+   context has somewhere to go on from, jump there, otherwise exit. */
+void
+dis10_fail (void)
+{
+  if (dis10->failure != NULL)
+    longjmp (*dis10->failure, 1);
+  exit (1);
+}
 
 static struct word_format *word_formats[] = {
   &aa_word_format,
@@ -36,7 +58,6 @@ static struct word_format *word_formats[] = {
   &x_word_format,
   NULL
 };
-static word_t checksum;
 
 void
 usage_word_format (void)
@@ -79,12 +100,77 @@ parse_output_word_format (const char *string)
 word_t
 get_word (FILE *f)
 {
+  word_t word;
+
   if (input_word_format->get_word == NULL)
     {
       fprintf (stderr, "word format \"%s\" not supported for input\n", input_word_format->name);
-      exit (1);
+      dis10_fail ();
+    }
+  word = input_word_format->get_word (f);
+  if (word != -1)
+    STATS_ADD (STATS_WORDS, 1);
+  return word;
+}
+
+/* Read up to n words into buffer.  Returns the number of words read.
+   These are the same words that repeated calls to get_word would
+   return. */
+int
+get_words (FILE *f, word_t *buffer, int n)
+{
+  word_t word;
+  int i;
+
+  if (input_word_format->get_words != NULL)
+    {
+      i = input_word_format->get_words (f, buffer, n);
+      STATS_ADD (STATS_WORDS, i);
+      return i;
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      word = get_word (f);
+      if (word == -1)
+	break;
+      buffer[i] = word;
+    }
+
+  return i;
+}
+
+/* Bulk reader for word formats which store each word in a fixed
+   number of octets.  Like the get_word functions for those formats,
+   a short word at the end of the file is padded with zero octets, and
+   there is no more input only after end of file has been seen. */
+int
+get_fixed_words (FILE *f, word_t *buffer, int n, int octets,
+		 void (*unpack) (const unsigned char *, word_t *, int))
+{
+  unsigned char data[8 * 1024];
+  int count = 0, m;
+  size_t size, got;
+
+  while (count < n && !feof (f) && !ferror (f))
+    {
+      m = n - count;
+      if (m > (int)sizeof data / octets)
+	m = sizeof data / octets;
+
+      size = (size_t)m * octets;
+      got = fread (data, 1, size, f);
+      if (got < size)
+	{
+	  memset (data + got, 0, size - got);
+	  m = got / octets + 1;
+	}
+
+      unpack (data, buffer + count, m);
+      count += m;
     }
-  return input_word_format->get_word (f);
+
+  return count;
 }
 
 void
@@ -105,11 +191,26 @@ write_word (FILE *f, word_t word)
   if (output_word_format->write_word == NULL)
     {
       fprintf (stderr, "word format \"%s\" not supported for output\n", output_word_format->name);
-      exit (1);
+      dis10_fail ();
     }
   output_word_format->write_word (f, word);
 }
 
+void
+write_words (FILE *f, const word_t *buffer, int n)
+{
+  int i;
+
+  if (output_word_format->write_words != NULL)
+    {
+      output_word_format->write_words (f, buffer, n);
+      return;
+    }
+
+  for (i = 0; i < n; i++)
+    write_word (f, buffer[i]);
+}
+
 void
 flush_word (FILE *f)
 {
@@ -122,14 +223,14 @@ flush_word (FILE *f)
 void
 reset_checksum (word_t word)
 {
-  checksum = word;
+  dis10->checksum = word;
 }
 
 void
 check_checksum (word_t word)
 {
-  if (word != checksum)
-    printf ("  [WARNING: bad checksum, %012llo /= %012llo]\n", word, checksum);
+  if (word != dis10->checksum)
+    fprintf (output_file, "  [WARNING: bad checksum, %012llo /= %012llo]\n", word, dis10->checksum);
 }
 
 word_t
@@ -137,8 +238,8 @@ get_checksummed_word (FILE *f)
 {
   word_t word = get_word (f);
 
-  checksum = (checksum << 1) + (checksum >> 35) + word;
-  checksum &= 0777777777777ULL;
+  dis10->checksum = (dis10->checksum << 1) + (dis10->checksum >> 35) + word;
+  dis10->checksum &= 0777777777777ULL;
 
   return word;
 }
@@ -43,7 +43,7 @@ get_x_word (FILE *f)
   if (word > WORDMASK)
     {
       fprintf (stderr, "[error in 36/8 format]\n");
-      exit (1);
+      dis10_fail ();
     }
 
   return word;
@@ -64,5 +64,7 @@ struct word_format x_word_format = {
   get_x_word,
   NULL,
   write_x_word,
+  NULL,
+  NULL,
   NULL
 };